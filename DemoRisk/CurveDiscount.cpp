@@ -1,8 +1,11 @@
 #include "CurveDiscount.h"
 #include "Market.h"
 #include "Streamer.h"
+#include "Profiler.h"
 
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 
 namespace minirisk {
@@ -10,26 +13,100 @@ namespace minirisk {
 CurveDiscount::CurveDiscount(Market *mkt, const Date& today, const string& curve_name)
     : m_today(today)
     , m_name(curve_name)
-    , m_rate(mkt->get_yield(curve_name.substr(ir_curve_discount_prefix.length(),3)))
 {
+    const Market::yield_curve_t rate(mkt->get_yield(curve_name.substr(ir_curve_discount_prefix.length(),3)));
+    std::shared_ptr<pillars_t> p(new pillars_t);
+    p->days.reserve(rate.size());
+    p->rt.reserve(rate.size());
+    p->slope.reserve(rate.size());
+    p->rf.reserve(rate.size());
+    for (const auto& r : rate) {
+        p->slope.push_back(p->days.empty() ? 0.0 : (r.second.first - p->rt.back()) / (r.first - p->days.back()));
+        p->days.push_back(r.first);
+        p->rt.push_back(r.second.first);
+        p->rf.push_back(r.second.second);
+    }
+    // make sure there is at least one segment, so that df(today) is always available
+    if (p->days.size() == 1) {
+        p->days.push_back(0);
+        p->rt.push_back(0.0);
+        p->slope.push_back(0.0);
+        p->rf.push_back(null_symbol);
+    }
+    m_pillars = p;
 }
 
-double CurveDiscount::df(const Date& t) const
+std::shared_ptr<const CurveDiscount> CurveDiscount::bump(symbol_t rf, double rate) const
+{
+    std::shared_ptr<CurveDiscount> res(new CurveDiscount(*this));
+
+    // a risk factor which is not a pillar (e.g. IR.1M.EUR if IR.30D.EUR is also quoted) does
+    // not affect the curve
+    const pillars_t& p = *m_pillars;
+    auto iter = std::find(p.rf.begin(), p.rf.end(), rf);
+    if (rf == null_symbol || iter == p.rf.end())
+        return res;
+    size_t k = iter - p.rf.begin();
+    if (m_bump != no_bump && m_bump != k)
+        return nullptr;
+
+    // same operations as in the constructor and in Market::get_yield, so that results are identical
+    res->m_bump = k;
+    res->m_bump_rt = p.days[k] * rate / 365.0;
+    res->m_bump_slope[0] = (res->m_bump_rt - rt(k - 1)) / (p.days[k] - p.days[k - 1]);
+    res->m_bump_slope[1] = k + 1 < p.days.size()
+        ? (rt(k + 1) - res->m_bump_rt) / (p.days[k + 1] - p.days[k])
+        : 0.0;
+    return res;
+}
+
+long CurveDiscount::day_diff(const Date& t) const
 {
-    MYASSERT((!(t < m_today)), "cannot get discount factor for date in the past: " << t);
-    auto m_rate_last = --m_rate.end();
-    long max_last_day = static_cast<long>(m_rate_last->first);
+    MYASSERT((!(t < m_today)), "Curve " << m_name << ", DF not available before anchor date " << m_today << ", requested " << t);
     long day_diff = t - m_today;
-    MYASSERT((!(day_diff > max_last_day)), "cannot get discount factor for date after last tensor date : " << t);
-    auto df = m_rate.lower_bound(day_diff); // pointing to Ti+1
-    unsigned t2 = df->first;
-    double rt2 = df->second;
-    --df; // pointing to Ti
-    unsigned t1 = df->first;
-    double rt1 = df->second;
-    double r = (rt2 - rt1) / (t2 - t1);
-    return std::exp(-rt1 - r * (day_diff - t1));
+    const unsigned last = m_pillars->days.back();
+    MYASSERT((!(day_diff > static_cast<long>(last))), "Curve " << m_name << ", DF not available beyond last tenor date " << Date(m_today.get_m_serial() + last) << ", requested " << t);
+    return day_diff;
+}
+
+double CurveDiscount::df(const Date& t) const
+{
+    PROFILE_COUNT(profile_df_calls);
+    return std::exp(log_df(day_diff(t)));
+}
+
+void CurveDiscount::df(const Date *t, double *out, size_t n) const
+{
+    // first interpolate, then exponentiate in a separate loop which can be vectorized.
+    // Dates out of range are flagged with NaN instead of throwing.
+    PROFILE_ADD(profile_df_calls, n);
+    const long last = m_pillars->days.back();
+    for (size_t i = 0; i < n; ++i) {
+        long d = t[i] - m_today;
+        out[i] = (d >= 0 && d <= last) ? log_df(d) : std::numeric_limits<double>::quiet_NaN();
+    }
+    for (size_t i = 0; i < n; ++i)
+        out[i] = std::exp(out[i]);
+}
+
+double CurveDiscount::df(const Date& t, double df_bar, risk_gradient_t& grad) const
+{
+    PROFILE_COUNT(profile_df_calls);
+    long d = day_diff(t);
+    double res = std::exp(log_df(d));
+    if (d == 0)
+        return res; // df is identically 1
 
+    // df = exp(-(1-w) * rt1 - w * rt2), with w = (t-t1)/(t2-t1) and rt_i = r_i * t_i / 365
+    const pillars_t& p = *m_pillars;
+    size_t k = segment(d);
+    double w = static_cast<double>(d - p.days[k - 1]) / (p.days[k] - p.days[k - 1]);
+    double e_bar = -res * df_bar; // adjoint of the exponent
+    if (p.rf[k - 1] != null_symbol)
+        grad[p.rf[k - 1]] += e_bar * (1.0 - w) * p.days[k - 1] / 365.0;
+    if (p.rf[k] != null_symbol)
+        grad[p.rf[k]] += e_bar * w * p.days[k] / 365.0;
+    return res;
 }
 
 } // namespace minirisk
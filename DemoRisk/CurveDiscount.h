@@ -1,6 +1,7 @@
 #pragma once
 #include "ICurve.h"
-#include <map>
+#include <vector>
+#include <memory>
 
 namespace minirisk {
 
@@ -15,12 +16,79 @@ struct CurveDiscount : ICurveDiscount
     // compute the discount factor
     double df(const Date& t) const;
 
+    // compute the discount factors for n dates at once, without throwing: the discount
+    // factor of a date out of the curve range is NaN
+    void df(const Date *t, double *out, size_t n) const;
+
+    // compute the discount factor and its sensitivities to the IR risk factors
+    double df(const Date& t, double df_bar, risk_gradient_t& grad) const;
+
     virtual Date today() const { return m_today; }
 
+    // Curve where the IR risk factor rf is set to rate. Only one pillar and the slopes of the
+    // two adjacent segments change: the bumped curve shares the pillar arrays with this curve
+    // and overrides them, in O(1). Returns null if this curve is already bumped on another
+    // pillar. The result is identical to the curve built from scratch with the modified rate.
+    std::shared_ptr<const CurveDiscount> bump(symbol_t rf, double rate) const;
+
+private:
+    // pillars, stored in contiguous arrays sorted by number of days (pillar 0 is today)
+    struct pillars_t
+    {
+        std::vector<unsigned> days;  // number of days from today
+        std::vector<double>   rt;    // r * t
+        std::vector<double>   slope; // slope[k] = slope of r * t between pillars k-1 and k
+        std::vector<symbol_t> rf;    // IR risk factor of each pillar
+    };
+
+    // index k of the pillar such that days[k-1] < t <= days[k] (or k=1 if t is today)
+    size_t segment(long day_diff) const
+    {
+        // the curve has few pillars: a branch-free linear scan is faster than a binary search
+        const std::vector<unsigned>& days = m_pillars->days;
+        size_t k = 1;
+        for (size_t i = 1, n = days.size(); i < n; ++i)
+            k += (days[i] < day_diff);
+        return k;
+    }
+
+    // r * t at pillar k and slope of segment k, taking into account the bumped pillar
+    // (selects which compile to conditional moves)
+    double rt(size_t k) const
+    {
+        return k == m_bump ? m_bump_rt : m_pillars->rt[k];
+    }
+    double slope(size_t k) const
+    {
+        double s = m_pillars->slope[k];
+        s = k == m_bump ? m_bump_slope[0] : s;
+        s = k == m_bump + 1 ? m_bump_slope[1] : s;
+        return s;
+    }
+
+    // number of days from today to t, checking that t is within the curve range
+    long day_diff(const Date& t) const;
+
+    // log of the discount factor, linearly interpolating r * t
+    double log_df(long day_diff) const
+    {
+        size_t k = segment(day_diff);
+        return -rt(k - 1) - slope(k) * (day_diff - m_pillars->days[k - 1]);
+    }
+
 private:
     Date   m_today;
     string m_name;
-    std::map<unsigned, double> m_rate;
+
+    // pillars, possibly shared with other curves
+    std::shared_ptr<const pillars_t> m_pillars;
+
+    // Bumped pillar (no_bump if none), with its r * t and the slopes of segments m_bump and
+    // m_bump+1. As no_bump+1 wraps around to 0, which is not a segment, no segment is overridden.
+    static const size_t no_bump = static_cast<size_t>(-1);
+    size_t m_bump = no_bump;
+    double m_bump_rt = 0.0;
+    double m_bump_slope[2] = { 0.0, 0.0 };
 };
 
 } // namespace minirisk
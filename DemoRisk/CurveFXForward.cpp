@@ -0,0 +1,70 @@
+#include "CurveFXForward.h"
+#include "Market.h"
+
+#include <vector>
+
+namespace minirisk {
+
+namespace {
+
+// parse a curve name with format FX.FWD.<ccy1>.<ccy2>
+fx_forward_ids_t parse_fx_forward(const string& curve_name)
+{
+    MYASSERT(curve_name.length() == fx_forward_prefix.length() + 7 && curve_name[fx_forward_prefix.length() + 3] == '.'
+        , "Invalid FX forward curve name " << curve_name);
+    return intern_fx_forward(curve_name.substr(fx_forward_prefix.length(), 3), curve_name.substr(fx_forward_prefix.length() + 4, 3));
+}
+
+} // namespace
+
+fx_forward_ids_t intern_fx_forward(const string& ccy1, const string& ccy2)
+{
+    return fx_forward_ids_t{ intern(fx_forward_name(ccy1, ccy2))
+        , intern(ir_curve_discount_name(ccy1))
+        , intern(ir_curve_discount_name(ccy2))
+        , intern(fx_spot_name(ccy1, ccy2)) };
+}
+
+CurveFXForward::CurveFXForward(Market *mkt, const Date& today, const string& curve_name)
+    : CurveFXForward(mkt, today, parse_fx_forward(curve_name))
+{
+}
+
+CurveFXForward::CurveFXForward(Market *mkt, const Date& today, const fx_forward_ids_t& ids)
+    : m_today(today)
+    , m_name(symbol_name(ids.fwd_curve))
+    , m_disc1(mkt->get_discount_curve(ids.disc1))
+    , m_disc2(mkt->get_discount_curve(ids.disc2))
+    , m_fx_spot(mkt->get_fx_spot_curve(ids.fx_spot))
+    , m_spot(m_fx_spot->spot())
+{
+}
+
+double CurveFXForward::fwd(const Date& t) const
+{
+    return m_spot * m_disc1->df(t) / m_disc2->df(t);
+}
+
+void CurveFXForward::fwd(const Date *t, double *out, size_t n) const
+{
+    // same operations as the scalar version, so that results are identical
+    std::vector<double> df2(n);
+    m_disc1->df(t, out, n);
+    m_disc2->df(t, df2.data(), n);
+    for (size_t i = 0; i < n; ++i)
+        out[i] = m_spot * out[i] / df2[i];
+}
+
+double CurveFXForward::fwd(const Date& t, double fwd_bar, risk_gradient_t& grad) const
+{
+    // fwd = s1 / s2 * df1 / df2
+    double df1 = m_disc1->df(t);
+    double df2 = m_disc2->df(t);
+    double res = m_spot * df1 / df2;
+    m_disc1->df(t, fwd_bar * m_spot / df2, grad);
+    m_disc2->df(t, -fwd_bar * res / df2, grad);
+    m_fx_spot->spot(fwd_bar * df1 / df2, grad);
+    return res;
+}
+
+} // namespace minirisk
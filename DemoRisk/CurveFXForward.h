@@ -0,0 +1,52 @@
+#pragma once
+#include "ICurve.h"
+
+namespace minirisk {
+
+struct Market;
+
+// interned names of an FX forward curve FX.FWD.<ccy1>.<ccy2> and of the curves it is implied from
+struct fx_forward_ids_t
+{
+    symbol_t fwd_curve;
+    symbol_t disc1;     // IR.DISCOUNT.<ccy1>
+    symbol_t disc2;     // IR.DISCOUNT.<ccy2>
+    symbol_t fx_spot;   // FX.SPOT.<ccy1>.<ccy2>, which is also the name of the FX pair fixing
+};
+
+// Intern all the names above. Pricers call it when they are created, so that the names are
+// known before the market is made concurrent.
+fx_forward_ids_t intern_fx_forward(const string& ccy1, const string& ccy2);
+
+// FX forward curve of currency ccy1 denominated in ccy2, implied by the FX spot and by the
+// discount curves of the two currencies: fwd(t) = spot * df1(t) / df2(t)
+struct CurveFXForward : ICurveFXForward
+{
+    virtual string name() const { return m_name; }
+
+    CurveFXForward(Market *mkt, const Date& today, const string& curve_name);
+
+    CurveFXForward(Market *mkt, const Date& today, const fx_forward_ids_t& ids);
+
+    // compute the FX forward price
+    double fwd(const Date& t) const;
+
+    // compute the FX forward prices for n dates at once
+    void fwd(const Date *t, double *out, size_t n) const;
+
+    // compute the FX forward price and its sensitivities to the risk factors
+    double fwd(const Date& t, double fwd_bar, risk_gradient_t& grad) const;
+
+    virtual Date today() const { return m_today; }
+
+private:
+    Date   m_today;
+    string m_name;
+
+    ptr_disc_curve_t m_disc1;   // discount curve of ccy1
+    ptr_disc_curve_t m_disc2;   // discount curve of ccy2
+    ptr_fx_spot_curve_t m_fx_spot;  // FX spot of ccy1 in ccy2
+    double m_spot;
+};
+
+} // namespace minirisk
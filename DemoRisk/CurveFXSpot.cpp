@@ -0,0 +1,33 @@
+#include "CurveFXSpot.h"
+#include "Market.h"
+
+namespace minirisk {
+
+CurveFXSpot::CurveFXSpot(Market *mkt, const Date& today, const string& curve_name)
+    : m_today(today)
+    , m_name(curve_name)
+{
+    // expected format is FX.SPOT.<ccy1>.<ccy2>
+    MYASSERT(curve_name.length() == fx_spot_prefix.length() + 7 && curve_name[fx_spot_prefix.length() + 3] == '.'
+        , "Invalid FX spot curve name " << curve_name);
+    const string ccy1 = curve_name.substr(fx_spot_prefix.length(), 3);
+    const string ccy2 = curve_name.substr(fx_spot_prefix.length() + 4, 3);
+
+    m_spot1 = ccy1 == "USD" ? null_symbol : intern(mds_spot_name(fx_spot_name(ccy1, "USD")));
+    m_spot2 = ccy2 == "USD" ? null_symbol : intern(mds_spot_name(fx_spot_name(ccy2, "USD")));
+    double spot1 = m_spot1 == null_symbol ? 1.0 : mkt->get_fx_spot(m_spot1);
+    m_spot2_value = m_spot2 == null_symbol ? 1.0 : mkt->get_fx_spot(m_spot2);
+    m_spot = spot1 / m_spot2_value;
+}
+
+double CurveFXSpot::spot(double spot_bar, risk_gradient_t& grad) const
+{
+    // spot = s1 / s2
+    if (m_spot1 != null_symbol)
+        grad[m_spot1] += spot_bar / m_spot2_value;
+    if (m_spot2 != null_symbol)
+        grad[m_spot2] -= spot_bar * m_spot / m_spot2_value;
+    return m_spot;
+}
+
+} // namespace minirisk
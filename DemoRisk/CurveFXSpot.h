@@ -0,0 +1,35 @@
+#pragma once
+#include "ICurve.h"
+
+namespace minirisk {
+
+struct Market;
+
+// FX spot of currency ccy1 denominated in ccy2 (e.g. FX.SPOT.EUR.GBP), derived from the
+// FX spots of the two currencies in USD. The cross rate is computed once when the curve is
+// built, hence once per market snapshot.
+struct CurveFXSpot : ICurveFXSpot
+{
+    virtual string name() const { return m_name; }
+
+    CurveFXSpot(Market *mkt, const Date& today, const string& curve_name);
+
+    // return the FX spot price
+    double spot() const { return m_spot; }
+
+    // return the FX spot price and its sensitivities to the risk factors
+    double spot(double spot_bar, risk_gradient_t& grad) const;
+
+    virtual Date today() const { return m_today; }
+
+private:
+    Date   m_today;
+    string m_name;
+
+    symbol_t m_spot1;           // FX spot of ccy1 in USD, null_symbol if ccy1 is USD
+    symbol_t m_spot2;           // FX spot of ccy2 in USD, null_symbol if ccy2 is USD
+    double   m_spot2_value;
+    double   m_spot;            // FX spot of ccy1 in ccy2
+};
+
+} // namespace minirisk
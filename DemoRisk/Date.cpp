@@ -1,6 +1,7 @@
 #include <iomanip>
 #include <iostream>
 #include <array>
+#include <algorithm>
 
 #include "Date.h"
 
@@ -0,0 +1,460 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+#include "MarketDataServer.h"
+#include "Market.h"
+#include "PortfolioUtils.h"
+#include "PortfolioBatch.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+#include "PortfolioBinary.h"
+#include "ThreadPool.h"
+#include "Macros.h"
+#include "Streamer.h"
+
+#ifndef _WIN32
+#  include <sys/resource.h>
+#endif
+
+using namespace::minirisk;
+
+// wall clock time elapsed since construction, in milliseconds
+struct Timer
+{
+    Timer() : m_start(std::chrono::steady_clock::now()) {}
+
+    double elapsed_ms() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// synthetic currency code number i (AAA, AAB, ...)
+string make_ccy(unsigned i)
+{
+    string ccy(3, 'A');
+    for (int k = 2; k >= 0; --k, i /= 26)
+        ccy[k] = static_cast<char>('A' + i % 26);
+    return ccy;
+}
+
+// write a risk factors file with n_ccy currencies and n_tenors IR tenors per currency
+void make_risk_factors(const string& filename, unsigned n_ccy, unsigned n_tenors)
+{
+    const char units[] = { 'D', 'W', 'M', 'Y' };
+    std::ofstream of(filename);
+    MYASSERT(!of.fail(), "Could not open file " << filename);
+    for (unsigned c = 0; c < n_ccy; ++c) {
+        string ccy = make_ccy(c);
+        of << fx_spot_prefix << ccy << " " << 1.0 + 0.001 * c << "\n";
+        for (unsigned t = 0; t < n_tenors; ++t)
+            of << ir_rate_prefix << (t / 4 + 1) << units[t % 4] << "." << ccy << " " << 0.01 + 0.001 * t << "\n";
+    }
+}
+
+// Compare the lookup of all IR tenors of each currency with a regular expression scan
+// against the structured risk factor index
+void bench_index(unsigned n_factors)
+{
+    const unsigned n_tenors = 40;
+    const unsigned n_ccy = std::max(1u, n_factors / (n_tenors + 1));
+    const string filename = "bench_risk_factors.tmp";
+
+    make_risk_factors(filename, n_ccy, n_tenors);
+    MarketDataServer mds(filename);
+
+    size_t n_regex = 0, n_index = 0;
+
+    Timer t_regex;
+    for (unsigned c = 0; c < n_ccy; ++c)
+        n_regex += mds.match(ir_rate_prefix + "\\d+[DWMY]." + make_ccy(c)).size();
+    double ms_regex = t_regex.elapsed_ms();
+
+    Timer t_index;
+    for (unsigned c = 0; c < n_ccy; ++c)
+        n_index += mds.index().ir_rates(make_ccy(c)).size();
+    double ms_index = t_index.elapsed_ms();
+
+    MYASSERT(n_regex == n_index, "Regex and index lookups do not match: " << n_regex << " vs " << n_index);
+
+    std::cout
+        << "Risk factor lookup (" << n_ccy * (n_tenors + 1) << " risk factors, " << n_ccy << " currencies)\n"
+        << format_label("regex scan [ms]") << ms_regex << "\n"
+        << format_label("index query [ms]") << ms_index << "\n"
+        << format_label("speedup") << ms_regex / ms_index << "\n";
+
+    std::remove(filename.c_str());
+}
+
+// Reference implementation of the discount factor, with the pillars stored in a std::map
+// as in the original CurveDiscount, used as a baseline for bench_df
+struct MapCurveDiscount
+{
+    MapCurveDiscount(Market& mkt, const Date& today, const string& ccy)
+        : m_today(today)
+    {
+        for (const auto& p : mkt.get_yield(ccy))
+            m_rate.emplace(p.first, p.second.first);
+    }
+
+    double df(const Date& t) const
+    {
+        MYASSERT((!(t < m_today)), "cannot get discount factor for date in the past: " << t);
+        long day_diff = t - m_today;
+        MYASSERT((!(day_diff > static_cast<long>((--m_rate.end())->first))), "cannot get discount factor for date after last tensor date : " << t);
+        auto df = m_rate.lower_bound(day_diff); // pointing to Ti+1
+        unsigned t2 = df->first;
+        double rt2 = df->second;
+        --df; // pointing to Ti
+        unsigned t1 = df->first;
+        double rt1 = df->second;
+        double r = (rt2 - rt1) / (t2 - t1);
+        return std::exp(-rt1 - r * (day_diff - t1));
+    }
+
+private:
+    Date m_today;
+    std::map<unsigned, double> m_rate;
+};
+
+// Compare the throughput of the discount factor calculation with map based storage,
+// flat storage and flat storage with batch evaluation
+void bench_df(unsigned n_dates)
+{
+    const unsigned n_tenors = 40;
+    const string filename = "bench_risk_factors.tmp";
+    const Date today(2017, 8, 5);
+
+    make_risk_factors(filename, 1, n_tenors);
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(filename));
+    Market mkt(mds, today);
+    const string ccy = make_ccy(0);
+    ptr_disc_curve_t curve = mkt.get_discount_curve(ir_curve_discount_name(ccy));
+    MapCurveDiscount map_curve(mkt, today, ccy);
+
+    // random dates within the curve range (last pillar is 10Y)
+    std::vector<Date> dates(n_dates);
+    srand(1234);
+    for (auto& d : dates)
+        d = Date(today.get_m_serial() + rand() % 3650);
+
+    std::vector<double> out_map(n_dates), out_flat(n_dates), out_batch(n_dates);
+
+    Timer t_map;
+    for (unsigned i = 0; i < n_dates; ++i)
+        out_map[i] = map_curve.df(dates[i]);
+    double ms_map = t_map.elapsed_ms();
+
+    Timer t_flat;
+    for (unsigned i = 0; i < n_dates; ++i)
+        out_flat[i] = curve->df(dates[i]);
+    double ms_flat = t_flat.elapsed_ms();
+
+    Timer t_batch;
+    curve->df(dates.data(), out_batch.data(), n_dates);
+    double ms_batch = t_batch.elapsed_ms();
+
+    MYASSERT(out_map == out_flat, "Map and flat discount factors do not match");
+    MYASSERT(out_map == out_batch, "Map and batch discount factors do not match");
+
+    std::cout
+        << "Discount factor throughput (" << n_dates << " dates, " << n_tenors << " pillars)\n"
+        << format_label("map [Mdf/s]") << n_dates / ms_map / 1000.0 << "\n"
+        << format_label("flat [Mdf/s]") << n_dates / ms_flat / 1000.0 << "\n"
+        << format_label("flat batch [Mdf/s]") << n_dates / ms_batch / 1000.0 << "\n";
+
+    std::remove(filename.c_str());
+}
+
+// random payments in n_ccy currencies, delivered within 10 years from today
+portfolio_t make_payments(unsigned n_trades, unsigned n_ccy, const Date& today)
+{
+    portfolio_t portfolio(n_trades);
+    srand(1234);
+    for (auto& pt : portfolio) {
+        TradePayment *p = new TradePayment;
+        p->init(make_ccy(rand() % n_ccy), 1.0 + rand() % 10000, Date(today.get_m_serial() + rand() % 3650));
+        pt.reset(p);
+    }
+    return portfolio;
+}
+
+// Compare pricing trade by trade via virtual calls against the columnar batch pricer
+void bench_batch(unsigned n_trades)
+{
+    const unsigned n_ccy = 4, n_tenors = 40;
+    const string filename = "bench_risk_factors.tmp";
+    const Date today(2017, 8, 5);
+
+    make_risk_factors(filename, n_ccy, n_tenors);
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(filename));
+    Market mkt(mds, today);
+
+    portfolio_t portfolio = make_payments(n_trades, n_ccy, today);
+    std::vector<ppricer_t> pricers(get_pricers(portfolio));
+    PortfolioBatch batch(portfolio, "USD");
+
+    // build all curves upfront, so that only pricing is measured
+    compute_prices(pricers, mkt);
+
+    Timer t_pricers;
+    portfolio_values_t pv_pricers = compute_prices(pricers, mkt);
+    double ms_pricers = t_pricers.elapsed_ms();
+
+    Timer t_batch;
+    portfolio_values_t pv_batch = batch.price(mkt);
+    double ms_batch = t_batch.elapsed_ms();
+
+    MYASSERT(pv_pricers == pv_batch, "Pricer and batch prices do not match");
+
+    std::cout
+        << "Payment pricing (" << n_trades << " trades, " << n_ccy << " currencies)\n"
+        << format_label("pricers [ms]") << ms_pricers << "\n"
+        << format_label("batch [ms]") << ms_batch << "\n"
+        << format_label("speedup") << ms_pricers / ms_batch << "\n";
+
+    std::remove(filename.c_str());
+}
+
+// Reference implementation of the text portfolio reader for payments, with one istringstream
+// per line and per token as in the original my_ifstream, used as a baseline for bench_load
+portfolio_t load_payments_legacy(const string& filename)
+{
+    portfolio_t portfolio;
+    std::ifstream is(filename);
+    MYASSERT(!is.fail(), "Could not open file " << filename);
+    string line;
+    while (std::getline(is, line) && line.length() > 0) {
+        std::istringstream line_stream(line);
+        string token, ccy;
+        guid_t id;
+        union { double d; uint64_t u; } quantity;
+        std::getline(line_stream, token, separator);
+        std::istringstream(token) >> id;
+        std::getline(line_stream, token, separator);
+        std::istringstream(token) >> std::hex >> quantity.u;
+        std::getline(line_stream, ccy, separator);
+        std::getline(line_stream, token, separator);
+        unsigned y = std::atoi(token.substr(0, 4).c_str());
+        unsigned m = std::atoi(token.substr(4, 2).c_str());
+        unsigned d = std::atoi(token.substr(6, 2).c_str());
+        MYASSERT(id == TradePayment::m_id, "Unexpected trade type " << id);
+        TradePayment *p = new TradePayment;
+        p->init(ccy, quantity.d, Date(y, m, d));
+        portfolio.emplace_back(p);
+    }
+    return portfolio;
+}
+
+// Compare the time to load a payment portfolio with the legacy text reader, the buffered
+// text reader and the memory mapped binary reader
+void bench_load(unsigned n_trades)
+{
+    const string txt_file = "bench_portfolio.tmp", bin_file = "bench_portfolio_bin.tmp";
+    const Date today(2017, 8, 5);
+
+    {
+        portfolio_t portfolio = make_payments(n_trades, 4, today);
+        save_portfolio(txt_file, portfolio);
+        save_portfolio_binary(bin_file, portfolio);
+    }
+
+    Timer t_legacy;
+    portfolio_t p_legacy = load_payments_legacy(txt_file);
+    double ms_legacy = t_legacy.elapsed_ms();
+
+    Timer t_text;
+    portfolio_t p_text = load_portfolio(txt_file);
+    double ms_text = t_text.elapsed_ms();
+
+    Timer t_bin;
+    portfolio_t p_bin = load_portfolio(bin_file);
+    double ms_bin = t_bin.elapsed_ms();
+
+    MYASSERT(p_legacy.size() == n_trades && p_text.size() == n_trades && p_bin.size() == n_trades, "Unexpected number of trades");
+    for (unsigned i = 0; i < n_trades; ++i) {
+        const TradePayment& a = static_cast<const TradePayment&>(*p_legacy[i]);
+        const TradePayment& b = static_cast<const TradePayment&>(*p_text[i]);
+        const TradePayment& c = static_cast<const TradePayment&>(*p_bin[i]);
+        MYASSERT(a.quantity() == b.quantity() && a.ccy() == b.ccy() && a.delivery_date() == b.delivery_date(), "Text readers do not match at trade " << i);
+        MYASSERT(a.quantity() == c.quantity() && a.ccy() == c.ccy() && a.delivery_date() == c.delivery_date(), "Text and binary readers do not match at trade " << i);
+    }
+
+    std::cout
+        << "Portfolio loading (" << n_trades << " payments)\n"
+        << format_label("legacy text [ms]") << ms_legacy << "\n"
+        << format_label("text [ms]") << ms_text << "\n"
+        << format_label("binary [ms]") << ms_bin << "\n";
+
+    std::remove(txt_file.c_str());
+    std::remove(bin_file.c_str());
+}
+
+// peak resident set size of the process in kilobytes (0 if not available)
+long peak_rss_kb()
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#  ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#  else
+    return usage.ru_maxrss;
+#  endif
+#endif
+}
+
+// random portfolio in n_ccy currencies: 80% payments and 20% FX forwards, all settled within
+// 10 years from today, so that they can be priced with the risk factors of make_risk_factors
+portfolio_t make_portfolio(unsigned n_trades, unsigned n_ccy, const Date& today)
+{
+    portfolio_t portfolio(n_trades);
+    srand(1234);
+    for (auto& pt : portfolio) {
+        if (n_ccy > 1 && rand() % 5 == 0) {
+            unsigned c1 = rand() % n_ccy, c2 = (c1 + 1 + rand() % (n_ccy - 1)) % n_ccy;
+            Date fixing(today.get_m_serial() + rand() % 3600);
+            TradeFXForward *f = new TradeFXForward;
+            f->init(make_ccy(c1), make_ccy(c2), 1.0 + rand() % 10000, 0.9 + 0.0001 * (rand() % 2000)
+                , fixing, Date(fixing.get_m_serial() + 2));
+            pt.reset(f);
+        }
+        else {
+            TradePayment *p = new TradePayment;
+            p->init(make_ccy(rand() % n_ccy), 1.0 + rand() % 10000, Date(today.get_m_serial() + rand() % 3650));
+            pt.reset(p);
+        }
+    }
+    return portfolio;
+}
+
+// End to end timing of the risk engine on a synthetic portfolio of n_trades trades in n_ccy
+// currencies, with n_tenors IR tenors per currency, using n_threads threads.
+// Results are reported as a single JSON object.
+void bench_risk(unsigned n_trades, unsigned n_ccy, unsigned n_tenors, unsigned n_threads)
+{
+    const string portfolio_file = "bench_portfolio_bin.tmp", risk_factors_file = "bench_risk_factors.tmp";
+    const Date today(2017, 8, 5);
+
+    // the last tenor must cover 10 years, so that all trades can be priced
+    MYASSERT(n_tenors >= 40, "At least 40 tenors are required, got " << n_tenors);
+    make_risk_factors(risk_factors_file, n_ccy, n_tenors);
+    save_portfolio_binary(portfolio_file, make_portfolio(n_trades, n_ccy, today));
+
+    ThreadPool pool(n_threads);
+
+    Timer t_load;
+    portfolio_t portfolio = load_portfolio(portfolio_file);
+    std::vector<ppricer_t> pricers(get_pricers(portfolio));
+    double ms_load = t_load.elapsed_ms();
+
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
+    Market mkt(mds, today);
+
+    Timer t_pv;
+    portfolio_values_t pv = compute_prices(pricers, mkt, pool);
+    double ms_pv = t_pv.elapsed_ms();
+    MYASSERT(portfolio_total(pv).second == 0, "Unexpected pricing errors");
+
+    mkt.disconnect();
+
+    size_t reprices_bucketed = 0, reprices_parallel = 0;
+
+    Timer t_bucketed;
+    auto pv01_bucketed = compute_pv01_bucketed(pricers, mkt, pool, &reprices_bucketed);
+    double ms_bucketed = t_bucketed.elapsed_ms();
+
+    Timer t_parallel;
+    auto pv01_parallel = compute_pv01_parallel(pricers, mkt, pool, &reprices_parallel);
+    double ms_parallel = t_parallel.elapsed_ms();
+
+    std::cout
+        << "{\"bench\": \"risk\""
+        << ", \"trades\": " << n_trades
+        << ", \"currencies\": " << n_ccy
+        << ", \"tenors\": " << n_tenors
+        << ", \"threads\": " << n_threads
+        << ",\n \"load\": {\"ms\": " << ms_load << ", \"trades_per_s\": " << n_trades / ms_load * 1000.0 << "}"
+        << ",\n \"pv\": {\"ms\": " << ms_pv << ", \"trades_per_s\": " << n_trades / ms_pv * 1000.0 << "}"
+        << ",\n \"pv01_bucketed\": {\"ms\": " << ms_bucketed << ", \"scenarios\": " << pv01_bucketed.size()
+        << ", \"reprices\": " << reprices_bucketed << ", \"reprices_per_s\": " << reprices_bucketed / ms_bucketed * 1000.0 << "}"
+        << ",\n \"pv01_parallel\": {\"ms\": " << ms_parallel << ", \"scenarios\": " << pv01_parallel.size()
+        << ", \"reprices\": " << reprices_parallel << ", \"reprices_per_s\": " << reprices_parallel / ms_parallel * 1000.0 << "}"
+        << ",\n \"peak_rss_kb\": " << peak_rss_kb()
+        << "}\n";
+
+    std::remove(portfolio_file.c_str());
+    std::remove(risk_factors_file.c_str());
+}
+
+void usage()
+{
+    std::cerr
+        << "Invalid command line arguments\n"
+        << "Example:\n"
+        << "DemoBench -b index [-n 10000]\n"
+        << "DemoBench -b df [-n 1000000]\n"
+        << "DemoBench -b batch [-n 1000000]\n"
+        << "DemoBench -b load [-n 1000000]\n"
+        << "DemoBench -b risk [-n 100000] [-c 8] [-T 40] [-t 1]\n"
+        << "  -c number of currencies, -T number of IR tenors per currency, -t number of threads\n";
+    std::exit(-1);
+}
+
+int main(int argc, const char **argv)
+{
+    // parse command line arguments
+    string bench;
+    unsigned n = 0, n_ccy = 8, n_tenors = 40, n_threads = 1;
+    if (argc % 2 == 0)
+        usage();
+    for (int i = 1; i < argc; i += 2) {
+        string key(argv[i]);
+        string value(argv[i+1]);
+        if (key == "-b")
+            bench = value;
+        else if (key == "-n")
+            n = static_cast<unsigned>(std::atoi(value.c_str()));
+        else if (key == "-c")
+            n_ccy = static_cast<unsigned>(std::atoi(value.c_str()));
+        else if (key == "-T")
+            n_tenors = static_cast<unsigned>(std::atoi(value.c_str()));
+        else if (key == "-t")
+            n_threads = static_cast<unsigned>(std::atoi(value.c_str()));
+        else
+            usage();
+    }
+    if (n_ccy == 0 || n_threads == 0)
+        usage();
+
+    try {
+        if (bench == "index")
+            bench_index(n ? n : 10000);
+        else if (bench == "df")
+            bench_df(n ? n : 1000000);
+        else if (bench == "batch")
+            bench_batch(n ? n : 1000000);
+        else if (bench == "load")
+            bench_load(n ? n : 1000000);
+        else if (bench == "risk")
+            bench_risk(n ? n : 100000, n_ccy, n_tenors, n_threads);
+        else
+            usage();
+        return 0;  // report success to the caller
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return -1; // report an error to the caller
+    }
+}
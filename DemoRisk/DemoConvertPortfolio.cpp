@@ -0,0 +1,62 @@
+#include <iostream>
+
+#include "PortfolioUtils.h"
+#include "PortfolioBinary.h"
+
+using namespace::minirisk;
+
+// convert a portfolio file between the text and the binary format
+void run(const string& input_file, const string& output_file, const string& format)
+{
+    // the input format is detected automatically
+    portfolio_t portfolio = load_portfolio(input_file);
+
+    if (format == "bin")
+        save_portfolio_binary(output_file, portfolio);
+    else
+        save_portfolio(output_file, portfolio);
+
+    std::cout << "Converted " << portfolio.size() << " trades from " << input_file << " to " << output_file << "\n";
+}
+
+void usage()
+{
+    std::cerr
+        << "Invalid command line arguments\n"
+        << "Example:\n"
+        << "DemoConvertPortfolio -i portfolio.txt -o portfolio.bin -f bin\n"
+        << "DemoConvertPortfolio -i portfolio.bin -o portfolio.txt -f txt\n";
+    std::exit(-1);
+}
+
+int main(int argc, const char **argv)
+{
+    // parse command line arguments
+    string input, output, format;
+    if (argc % 2 == 0)
+        usage();
+    for (int i = 1; i < argc; i += 2) {
+        string key(argv[i]);
+        string value(argv[i+1]);
+        if (key == "-i")
+            input = value;
+        else if (key == "-o")
+            output = value;
+        else if (key == "-f")
+            format = value;
+        else
+            usage();
+    }
+    if (input == "" || output == "" || (format != "bin" && format != "txt"))
+        usage();
+
+    try {
+        run(input, output, format);
+        return 0;  // report success to the caller
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return -1; // report an error to the caller
+    }
+}
@@ -3,36 +3,96 @@
 
 #include "MarketDataServer.h"
 #include "PortfolioUtils.h"
+#include "PortfolioBatch.h"
+#include "ThreadPool.h"
+#include "RiskCube.h"
+#include "ResultSink.h"
+#include "Profiler.h"
+#include "HistoricalVaR.h"
 
 using namespace::minirisk;
 
-void run(const string& portfolio_file, const string& risk_factors_file)
+// command line options
+struct options_t
 {
+    string portfolio_file;
+    string risk_factors_file;
+    string fixings_file;      // optional
+    string base_ccy = "USD";  // currency of the reported results
+    unsigned n_threads = 1;
+    bool analytic = false;
+    bool round_trip = true;
+    bool per_trade = false;   // print the value of every trade instead of aggregated results
+    std::vector<group_by_t> group_by = { group_by_currency };
+    string output_file;       // optional, all per-trade results are written to it
+    string output_format = "csv";
+    string history_file;      // optional, enables the historical VaR
+    double confidence = 0.99; // confidence level of the historical VaR
+};
+
+void run(const options_t& opt)
+{
+    const string& portfolio_file = opt.portfolio_file;
+    const unsigned n_threads = opt.n_threads;
+
     // load the portfolio from file
-    portfolio_t portfolio = load_portfolio(portfolio_file);
+    portfolio_t portfolio;
+    {
+        PROFILE_SCOPE("load");
+        portfolio = load_portfolio(portfolio_file);
+    }
     // save and reload portfolio to implicitly test round trip serialization
-    save_portfolio("portfolio.tmp", portfolio);
-    portfolio.clear();
-    portfolio = load_portfolio("portfolio.tmp");
+    if (opt.round_trip) {
+        PROFILE_SCOPE("round trip");
+        save_portfolio("portfolio.tmp", portfolio);
+        portfolio.clear();
+        portfolio = load_portfolio("portfolio.tmp");
+    }
 
     // display portfolio
     print_portfolio(portfolio);
 
     // get pricers
-    std::vector<ppricer_t> pricers(get_pricers(portfolio));
+    std::vector<ppricer_t> pricers(get_pricers(portfolio, opt.base_ccy));
 
     // initialize market data server
-    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(opt.risk_factors_file));
+
+    // initialize fixing data server
+    std::shared_ptr<const FixingDataServer> fds;
+    if (!opt.fixings_file.empty())
+        fds.reset(new FixingDataServer(opt.fixings_file));
 
     // Init market object
     Date today(2017,8,5);
-    Market mkt(mds, today);
+    Market mkt(mds, today, fds);
+
+    // worker threads shared by all the computations below
+    ThreadPool pool(n_threads);
+
+    // results are aggregated into a risk cube, unless the value of every trade is requested
+    // The full results can also be streamed to a file.
+    RiskCube cube(portfolio, today, opt.group_by);
+    presult_sink_t sink;
+    if (!opt.output_file.empty())
+        sink = make_result_sink(opt.output_file, opt.output_format);
+    auto report = [&opt, &cube, &sink](const string& name, const portfolio_values_t& values) {
+        if (sink)
+            sink->write(name, values);
+        if (opt.per_trade)
+            print_price_vector(name, values);
+        else
+            cube.add(name, values);
+    };
 
     // Price all products. Market objects are automatically constructed on demand,
     // fetching data as needed from the market data server.
+    // Homogeneous trades are grouped and priced in batch.
     {
-        auto prices = compute_prices(pricers, mkt);
-        print_price_vector("PV", prices);
+        PROFILE_SCOPE("PV");
+        PortfolioBatch batch(portfolio, opt.base_ccy);
+        auto prices = batch.price(mkt, pool);
+        report("PV", prices);
     }
 
     // disconnect the market (no more fetching from the market data server allowed)
@@ -43,7 +103,7 @@ void run(const string& portfolio_file, const string& risk_factors_file)
         std::cout << "Risk factors:\n";
         auto tmp = mkt.get_risk_factors(".+");
         for (const auto& iter : tmp)
-            std::cout << iter.first << "\n";
+            std::cout << symbol_name(iter.first) << "\n";
         std::cout << "\n";
     }
 
@@ -55,19 +115,68 @@ void run(const string& portfolio_file, const string& risk_factors_file)
     //         print_price_vector("PV01 " + g.first, g.second);
     // }
 
-    {   // Compute PV01 Bucketed (i.e. computes risk with respect to individual yield curves)
-        std::vector<std::pair<string, portfolio_values_t>> pv01_bucketed(compute_pv01_bucketed(pricers,mkt));
-        // display PV01 per currency per tensor
-        for (const auto& g : pv01_bucketed)
-            print_price_vector("PV01 " + g.first, g.second);
+    if (opt.analytic) {
+        {   // Compute PV01 Bucketed and Parallel from the price gradients, in a single pass
+            PROFILE_SCOPE("PV01 analytic");
+            std::vector<std::pair<string, portfolio_values_t>> pv01_bucketed, pv01_parallel;
+            compute_pv01_analytic(pricers, mkt, pv01_bucketed, pv01_parallel);
+            for (const auto& g : pv01_bucketed)
+                report("PV01 " + g.first, g.second);
+            for (const auto& g : pv01_parallel)
+                report("PV01 " + g.first, g.second);
+        }
+
+        {   // Compute FX delta per spot from the price gradients
+            PROFILE_SCOPE("FX delta analytic");
+            for (const auto& g : compute_fx_delta_analytic(pricers, mkt))
+                report(g.first, g.second);
+        }
     }
+    else {
+        {   // Compute PV01 Bucketed (i.e. computes risk with respect to individual yield curves)
+            PROFILE_SCOPE("PV01 bucketed");
+            std::vector<std::pair<string, portfolio_values_t>> pv01_bucketed(compute_pv01_bucketed(pricers,mkt,pool));
+            // display PV01 per currency per tensor
+            for (const auto& g : pv01_bucketed)
+                report("PV01 " + g.first, g.second);
+        }
+
+        {   // Compute PV01 Parallel (i.e. computes risk with respect to parallel shift of the yield curve)
+            PROFILE_SCOPE("PV01 parallel");
+            std::vector<std::pair<string, portfolio_values_t>> pv01_parallel(compute_pv01_parallel(pricers,mkt,pool));
+            // display PV01 per currency
+            for (const auto& g : pv01_parallel)
+                report("PV01 " + g.first, g.second);
+        }
 
-    {   // Compute PV01 Parallel (i.e. computes risk with respect to parallel shift of the yield curve)
-        std::vector<std::pair<string, portfolio_values_t>> pv01_parallel(compute_pv01_parallel(pricers,mkt));
-        // display PV01 per currency
-        for (const auto& g : pv01_parallel)
-            print_price_vector("PV01 " + g.first, g.second);
+        {   // Compute FX delta (i.e. computes risk with respect to the FX spot of each currency)
+            PROFILE_SCOPE("FX delta");
+            std::vector<std::pair<string, portfolio_values_t>> fx_delta(compute_fx_delta(pricers,mkt,pool));
+            // display FX delta per currency
+            for (const auto& g : fx_delta)
+                report(g.first, g.second);
+        }
     }
+
+    if (!opt.history_file.empty()) {   // Compute historical VaR and ES, with the contribution of each trade
+        RiskFactorHistory history(opt.history_file);
+        historical_var_t var = compute_historical_var(pricers, mkt, history, opt.confidence, pool);
+        print_historical_var(var);
+        report("VaR contribution", var.var_contributions);
+        report("ES contribution", var.es_contributions);
+    }
+
+    {
+        PROFILE_SCOPE("output");
+        if (sink)
+            sink->close();
+
+        // display the aggregated results
+        if (!opt.per_trade)
+            cube.print(std::cout);
+    }
+
+    PROFILE_REPORT(std::cout);
 }
 
 void usage()
@@ -75,31 +184,68 @@ void usage()
     std::cerr
         << "Invalid command line arguments\n"
         << "Example:\n"
-        << "DemoRisk -p portfolio.txt -f risk_factors.txt\n";
+        << "DemoRisk -p portfolio.txt -f risk_factors.txt [-x fixings.txt] [-b base_ccy] [-t num_threads] [-m fd|analytic] [-r 0|1] [-g ccy,type,maturity] [-d 0|1] [-o results_file] [--format csv|bin] [-v history_file] [-q confidence]\n"
+        << "  -r 0 skips the portfolio.tmp serialization round trip\n"
+        << "  -g aggregates the results by currency, trade type and/or maturity bucket (default ccy)\n"
+        << "  -d 1 prints the value of every trade instead of the aggregated results\n"
+        << "  -o writes the value of every trade to results_file, in csv (default) or columnar binary format\n"
+        << "  -v computes the historical VaR and ES at the confidence level given by -q (default 0.99)\n"
+        << "     from daily risk factors, either in the format <name> <YYYYMMDD> <value>\n"
+        << "     or as an index of daily risk factor files in the format <YYYYMMDD> <file>\n";
     std::exit(-1);
 }
 
 int main(int argc, const char **argv)
 {
     // parse command line arguments
-    string portfolio, riskfactors;
+    options_t opt;
+    string method = "fd";
     if (argc % 2 == 0)
         usage();
     for (int i = 1; i < argc; i += 2) {
         string key(argv[i]);
         string value(argv[i+1]);
         if (key == "-p")
-            portfolio = value;
+            opt.portfolio_file = value;
         else if (key == "-f")
-            riskfactors = value;
+            opt.risk_factors_file = value;
+        else if (key == "-x")
+            opt.fixings_file = value;
+        else if (key == "-b")
+            opt.base_ccy = value;
+        else if (key == "-m")
+            method = value;
+        else if (key == "-t")
+            opt.n_threads = static_cast<unsigned>(std::atoi(value.c_str()));
+        else if (key == "-r" && (value == "0" || value == "1"))
+            opt.round_trip = value == "1";
+        else if (key == "-v")
+            opt.history_file = value;
+        else if (key == "-q")
+            opt.confidence = std::atof(value.c_str());
+        else if (key == "-o")
+            opt.output_file = value;
+        else if (key == "--format" && (value == "csv" || value == "bin"))
+            opt.output_format = value;
+        else if (key == "-d" && (value == "0" || value == "1"))
+            opt.per_trade = value == "1";
+        else if (key == "-g") {
+            try {
+                opt.group_by = parse_group_by(value);
+            }
+            catch (const std::exception&) {
+                usage();
+            }
+        }
         else
             usage();
     }
-    if (portfolio == "" || riskfactors == "")
+    if (opt.portfolio_file == "" || opt.risk_factors_file == "" || opt.base_ccy.length() != 3 || opt.n_threads == 0 || opt.confidence <= 0.0 || opt.confidence >= 1.0 || (method != "fd" && method != "analytic"))
         usage();
+    opt.analytic = method == "analytic";
 
     try {
-        run(portfolio, riskfactors);
+        run(opt);
         return 0;  // report success to the caller
     }
     catch (const std::exception& e)
@@ -0,0 +1,66 @@
+#include "FixingDataServer.h"
+#include "Streamer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+
+namespace minirisk {
+
+FixingDataServer::FixingDataServer(const string& filename)
+{
+    std::ifstream is(filename);
+    MYASSERT(!is.fail(), "Could not open file " << filename);
+
+    std::vector<uint64_t> keys;
+    std::vector<double> values;
+    string name;
+    unsigned yyyymmdd;
+    double value;
+    while (is >> name >> yyyymmdd >> value) {
+        Date t(yyyymmdd / 10000, (yyyymmdd / 100) % 100, yyyymmdd % 100);
+        keys.push_back(key(intern(name), t));
+        values.push_back(value);
+    }
+    MYASSERT(is.eof(), "Invalid fixing in file " << filename << " after " << keys.size() << " fixings");
+
+    // sort by key
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    m_keys.reserve(keys.size());
+    m_values.reserve(keys.size());
+    for (size_t i : order) {
+        MYASSERT(m_keys.empty() || m_keys.back() != keys[i]
+            , "Duplicated fixing: " << symbol_name(static_cast<symbol_t>(keys[i] >> 32)) << "," << Date(static_cast<unsigned>(keys[i])));
+        m_keys.push_back(keys[i]);
+        m_values.push_back(values[i]);
+    }
+}
+
+double FixingDataServer::get(const string& name, const Date& t) const
+{
+    auto res = lookup(find_symbol(name), t);
+    MYASSERT(res.second, "Fixing not found: " << name << "," << t);
+    return res.first;
+}
+
+double FixingDataServer::get(symbol_t id, const Date& t) const
+{
+    auto res = lookup(id, t);
+    MYASSERT(res.second, "Fixing not found: " << symbol_name(id) << "," << t);
+    return res.first;
+}
+
+std::pair<double, bool> FixingDataServer::lookup(symbol_t id, const Date& t) const
+{
+    if (id == null_symbol)
+        return std::make_pair(std::numeric_limits<double>::quiet_NaN(), false);
+    const uint64_t k = key(id, t);
+    auto iter = std::lower_bound(m_keys.begin(), m_keys.end(), k);
+    return (iter != m_keys.end() && *iter == k)  // found?
+            ? std::make_pair(m_values[iter - m_keys.begin()], true)
+            : std::make_pair(std::numeric_limits<double>::quiet_NaN(), false);
+}
+
+} // namespace minirisk
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Global.h"
+#include "Date.h"
+#include "SymbolTable.h"
+
+namespace minirisk {
+
+// Historical fixings (e.g. FX.SPOT.EUR.USD on 4-8-2017), pre-loaded from a file where each
+// line is in the format: <name> <YYYYMMDD> <value>
+// Fixings are stored in a flat array sorted by (interned name, date serial) and looked up by
+// binary search, so that no string is parsed when pricing.
+struct FixingDataServer
+{
+public:
+    FixingDataServer(const string& filename);
+
+    // queries, throwing if the fixing is not available
+    double get(const string& name, const Date& t) const;
+    double get(symbol_t id, const Date& t) const;
+    std::pair<double, bool> lookup(symbol_t id, const Date& t) const;
+
+    size_t size() const { return m_keys.size(); }
+
+private:
+    static uint64_t key(symbol_t id, const Date& t)
+    {
+        return (static_cast<uint64_t>(id) << 32) | t.get_m_serial();
+    }
+
+    std::vector<uint64_t> m_keys;   // sorted (name, date) keys
+    std::vector<double> m_values;   // value of each key
+};
+
+} // namespace minirisk
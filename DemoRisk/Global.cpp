@@ -7,6 +7,7 @@ namespace minirisk {
 const string ir_rate_prefix = "IR.";
 const string ir_curve_discount_prefix = "IR.DISCOUNT.";
 const string fx_spot_prefix = "FX.SPOT.";
+const string fx_forward_prefix = "FX.FWD.";
 
 string format_label(const string& s)
 {
@@ -11,6 +11,7 @@ namespace minirisk {
 extern const string ir_rate_prefix;
 extern const string ir_curve_discount_prefix;
 extern const string fx_spot_prefix;
+extern const string fx_forward_prefix;
 
 inline string ir_curve_discount_name(const string& ccy)
 {
@@ -22,6 +23,11 @@ inline string fx_spot_name(const string& ccy1, const string& ccy2)
     return fx_spot_prefix + ccy1 + "." + ccy2;
 }
 
+inline string fx_forward_name(const string& ccy1, const string& ccy2)
+{
+    return fx_forward_prefix + ccy1 + "." + ccy2;
+}
+
 string format_label(const string& s);
 
 } // namespace minirisk
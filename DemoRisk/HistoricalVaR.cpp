@@ -0,0 +1,235 @@
+#include "HistoricalVaR.h"
+#include "Market.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include "Streamer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <limits>
+#include <cmath>
+#include <map>
+
+namespace minirisk {
+
+static Date parse_yyyymmdd(unsigned yyyymmdd)
+{
+    return Date(yyyymmdd / 10000, (yyyymmdd / 100) % 100, yyyymmdd % 100);
+}
+
+// directory of a file name, including the trailing separator
+static string directory_of(const string& filename)
+{
+    size_t pos = filename.find_last_of("/\\");
+    return pos == string::npos ? string() : filename.substr(0, pos + 1);
+}
+
+RiskFactorHistory::RiskFactorHistory(const string& filename)
+{
+    std::ifstream is(filename);
+    MYASSERT(!is.fail(), "Could not open file " << filename);
+
+    // the number of tokens of the first line determines the format
+    string line;
+    while (std::getline(is, line) && line.find_first_not_of(" \t\r") == string::npos)
+        ;
+    std::istringstream first(line);
+    string token;
+    size_t n_tokens = 0;
+    while (first >> token)
+        ++n_tokens;
+    MYASSERT(n_tokens == 2 || n_tokens == 3, "Invalid history file " << filename);
+    is.clear();
+    is.seekg(0);
+
+    std::map<unsigned, std::map<symbol_t, double>> data;  // date serial -> risk factor -> value
+    if (n_tokens == 3) {
+        string name;
+        unsigned yyyymmdd;
+        double value;
+        while (is >> name >> yyyymmdd >> value)
+            MYASSERT(data[parse_yyyymmdd(yyyymmdd).get_m_serial()].emplace(intern(name), value).second
+                , "Duplicated risk factor " << name << " on " << yyyymmdd);
+        MYASSERT(is.eof(), "Invalid risk factor in file " << filename);
+    }
+    else {
+        unsigned yyyymmdd;
+        string daily_file;
+        while (is >> yyyymmdd >> daily_file) {
+            if (daily_file[0] != '/')
+                daily_file = directory_of(filename) + daily_file;
+            std::ifstream ds(daily_file);
+            MYASSERT(!ds.fail(), "Could not open file " << daily_file);
+            std::map<symbol_t, double>& day = data[parse_yyyymmdd(yyyymmdd).get_m_serial()];
+            MYASSERT(day.empty(), "Duplicated date " << yyyymmdd << " in file " << filename);
+            string name;
+            double value;
+            while (ds >> name >> value)
+                MYASSERT(day.emplace(intern(name), value).second, "Duplicated risk factor " << name << " in file " << daily_file);
+            MYASSERT(ds.eof(), "Invalid risk factor in file " << daily_file);
+        }
+        MYASSERT(is.eof(), "Invalid line in file " << filename);
+    }
+
+    // dense storage
+    std::map<symbol_t, size_t> columns;
+    for (const auto& day : data)
+        for (const auto& rf : day.second)
+            columns.emplace(rf.first, 0);
+    for (auto& c : columns) {
+        c.second = m_ids.size();
+        m_ids.push_back(c.first);
+    }
+    m_values.assign(data.size() * m_ids.size(), std::numeric_limits<double>::quiet_NaN());
+    for (const auto& day : data) {
+        double *row = &m_values[m_dates.size() * m_ids.size()];
+        for (const auto& rf : day.second)
+            row[columns[rf.first]] = rf.second;
+        m_dates.push_back(Date(day.first));
+    }
+}
+
+double RiskFactorHistory::value(size_t d, symbol_t id) const
+{
+    auto iter = std::lower_bound(m_ids.begin(), m_ids.end(), id);
+    return (iter != m_ids.end() && *iter == id)
+        ? m_values[d * m_ids.size() + (iter - m_ids.begin())]
+        : std::numeric_limits<double>::quiet_NaN();
+}
+
+namespace {
+
+// a risk factor of the base market shocked by the history
+struct shocked_factor_t
+{
+    Market::risk_factor_t base;
+    bool relative;              // relative shock (FX spots) or absolute (all others)
+};
+
+// base market shocked by the change of the risk factors between days s-1 and s of the history
+Market::vec_risk_factor_t shocked_market(const std::vector<shocked_factor_t>& factors, const RiskFactorHistory& history, size_t s)
+{
+    Market::vec_risk_factor_t res;
+    res.reserve(factors.size());
+    for (const auto& f : factors) {
+        double prev = history.value(s - 1, f.base.first);
+        double curr = history.value(s, f.base.first);
+        double v = f.base.second;
+        if (!std::isnan(prev) && !std::isnan(curr))
+            v = f.relative ? v * (curr / prev) : v + (curr - prev);
+        res.emplace_back(f.base.first, v);
+    }
+    return res;
+}
+
+} // namespace
+
+historical_var_t compute_historical_var(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , const RiskFactorHistory& history, double confidence, ThreadPool& pool)
+{
+    PROFILE_SCOPE("historical VaR");
+    MYASSERT(confidence > 0.0 && confidence < 1.0, "Invalid confidence level " << confidence);
+    MYASSERT(history.size() > 1, "At least two days of history are required, got " << history.size());
+
+    historical_var_t res;
+    res.confidence = confidence;
+    res.n_scenarios = history.size() - 1;
+    res.n_tail = std::max<size_t>(1, static_cast<size_t>(std::ceil((1.0 - confidence) * res.n_scenarios - 1e-9)));
+
+    // risk factors of the base market, in a fixed order
+    std::vector<shocked_factor_t> factors;
+    for (auto asset_class : { RiskFactorKey::ir_rate, RiskFactorKey::fx_spot, RiskFactorKey::other })
+        for (const auto& rf : mkt.get_risk_factors(asset_class))
+            factors.push_back(shocked_factor_t{ rf, asset_class == RiskFactorKey::fx_spot });
+    Market::vec_risk_factor_t base(factors.size());
+    std::transform(factors.begin(), factors.end(), base.begin(), [](const shocked_factor_t& f) { return f.base; });
+
+    Market basemkt(mkt);
+    const portfolio_values_t pv_base = compute_prices(pricers, basemkt);
+
+    // one market per thread, shocked and restored for every scenario
+    std::vector<Market> mkts(pool.size(), mkt);
+    auto reprice = [&](size_t scenario, unsigned thread) {
+        Market& tmpmkt = mkts[thread];
+        tmpmkt.set_risk_factors(shocked_market(factors, history, scenario + 1));
+        portfolio_values_t pv = compute_prices(pricers, tmpmkt);
+        tmpmkt.set_risk_factors(base);
+        return pv;
+    };
+
+    // first pass: P&L of the portfolio in each scenario
+    std::vector<double> pnl(res.n_scenarios);
+    pool.parallel_for(res.n_scenarios, 1, [&](size_t begin, size_t end, unsigned thread) {
+        for (size_t s = begin; s < end; ++s) {
+            portfolio_values_t pv = reprice(s, thread);
+            double total = 0.0;
+            for (size_t i = 0; i < pv.size(); ++i)
+                if (!is_error(pv_base[i]) && !is_error(pv[i]))
+                    total += pv[i].first - pv_base[i].first;
+            pnl[s] = total;
+        }
+    });
+
+    // worst scenarios first
+    std::vector<size_t> order(res.n_scenarios);
+    for (size_t s = 0; s < order.size(); ++s)
+        order[s] = s;
+    std::stable_sort(order.begin(), order.end(), [&pnl](size_t a, size_t b) { return pnl[a] < pnl[b]; });
+    order.resize(res.n_tail);
+
+    // second pass: per-trade P&L in the tail scenarios
+    std::vector<portfolio_values_t> tail(res.n_tail);
+    pool.parallel_for(res.n_tail, 1, [&](size_t begin, size_t end, unsigned thread) {
+        for (size_t k = begin; k < end; ++k)
+            tail[k] = reprice(order[k], thread);
+    });
+
+    res.var = -pnl[order.back()];
+    for (size_t s : order) {
+        res.es -= pnl[s];
+        res.tail_dates.push_back(history.dates()[s + 1]);
+    }
+    res.es /= res.n_tail;
+
+    res.var_contributions.assign(pricers.size(), trade_value(0.0));
+    res.es_contributions.assign(pricers.size(), trade_value(0.0));
+    for (size_t i = 0; i < pricers.size(); ++i) {
+        if (is_error(pv_base[i])) {
+            res.var_contributions[i] = res.es_contributions[i] = pv_base[i];
+            continue;
+        }
+        for (size_t k = 0; k < res.n_tail; ++k) {
+            const trade_value_t& v = tail[k][i];
+            if (is_error(v)) {
+                res.es_contributions[i] = v;
+                if (k + 1 == res.n_tail)
+                    res.var_contributions[i] = v;
+            }
+            else {
+                if (!is_error(res.es_contributions[i]))
+                    res.es_contributions[i].first -= (v.first - pv_base[i].first) / res.n_tail;
+                if (k + 1 == res.n_tail)
+                    res.var_contributions[i].first = pv_base[i].first - v.first;
+            }
+        }
+    }
+    return res;
+}
+
+void print_historical_var(const historical_var_t& var)
+{
+    std::cout
+        << "========================\n"
+        << "Historical VaR:\n"
+        << "========================\n"
+        << format_label("Scenarios") << var.n_scenarios << "\n"
+        << format_label("Confidence") << var.confidence << "\n"
+        << format_label("VaR") << var.var << "\n"
+        << format_label("ES") << var.es << "\n"
+        << format_label("Tail scenarios") << var.tail_dates << "\n"
+        << "========================\n\n";
+}
+
+} // namespace minirisk
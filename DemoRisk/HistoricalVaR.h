@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include "Global.h"
+#include "Date.h"
+#include "SymbolTable.h"
+#include "PortfolioUtils.h"
+
+namespace minirisk {
+
+struct Market;
+struct ThreadPool;
+
+// Daily history of risk factor values, loaded either from a single file where each line is in
+// the format: <name> <YYYYMMDD> <value>
+// or from an index file where each line is in the format: <YYYYMMDD> <risk factors file>
+// referring to one file per day in the same format as the market data server files (relative
+// paths are relative to the directory of the index file).
+// Values are stored in a dense days x risk factors array, NaN if not available.
+struct RiskFactorHistory
+{
+    RiskFactorHistory(const string& filename);
+
+    // number of days
+    size_t size() const { return m_dates.size(); }
+
+    // dates, sorted
+    const std::vector<Date>& dates() const { return m_dates; }
+
+    // value of risk factor id on day d (NaN if not available)
+    double value(size_t d, symbol_t id) const;
+
+private:
+    std::vector<Date> m_dates;
+    std::vector<symbol_t> m_ids;    // risk factors, sorted
+    std::vector<double> m_values;   // days x risk factors, day major
+};
+
+struct historical_var_t
+{
+    double confidence = 0.0;
+    size_t n_scenarios = 0;
+    size_t n_tail = 0;              // number of scenarios in the tail
+    double var = 0.0;               // loss of the n_tail-th worst scenario
+    double es = 0.0;                // average loss of the n_tail worst scenarios
+    std::vector<Date> tail_dates;   // dates of the tail scenarios, worst first
+    portfolio_values_t var_contributions;  // loss of each trade in the VaR scenario
+    portfolio_values_t es_contributions;   // average loss of each trade in the tail scenarios
+};
+
+// Compute the historical VaR and expected shortfall of the portfolio at a given confidence level.
+// Scenario s applies to the base market the change of the risk factors between consecutive days
+// s-1 and s of the history: absolute for IR rates and relative for FX spots. Risk factors not
+// available on both days are not shocked.
+// Scenarios are distributed over the threads of pool, each of them owning a single copy of the
+// market which is shocked and restored for every scenario, so that memory does not grow with
+// the length of the history. A first pass computes the P&L of the portfolio in all scenarios,
+// a second pass reprices the tail scenarios only, to compute the per-trade contributions.
+// Trades which cannot be priced in a scenario do not contribute to its P&L.
+historical_var_t compute_historical_var(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , const RiskFactorHistory& history, double confidence, ThreadPool& pool);
+
+// print VaR and ES to cout
+void print_historical_var(const historical_var_t& var);
+
+} // namespace minirisk
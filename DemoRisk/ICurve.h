@@ -2,9 +2,11 @@
 
 #include <memory>
 #include <string>
+#include <map>
 
 #include "IObject.h"
 #include "Date.h"
+#include "SymbolTable.h"
 
 using std::string;
 
@@ -22,20 +24,43 @@ struct ICurve : IObject
 
 // forward declaration
 struct ICurveDiscount;
+struct ICurveFXForward;
+struct ICurveFXSpot;
 
 typedef std::shared_ptr<const ICurve> ptr_curve_t;
 typedef std::shared_ptr<const ICurveDiscount> ptr_disc_curve_t;
+typedef std::shared_ptr<const ICurveFXForward> ptr_fwd_curve_t;
+typedef std::shared_ptr<const ICurveFXSpot> ptr_fx_spot_curve_t;
+
+// sensitivities of a value with respect to the risk factors it depends on
+typedef std::map<symbol_t, double> risk_gradient_t;
 
 struct ICurveDiscount : ICurve
 {
     // compute the discount factor for date t
     virtual double df(const Date& t) const = 0;
+
+    // compute the discount factors for n dates at once, without throwing: the discount
+    // factor of a date out of the curve range is NaN
+    virtual void df(const Date *t, double *out, size_t n) const = 0;
+
+    // compute the discount factor for date t and propagate the adjoint df_bar = dV/d(df)
+    // to the risk factors of the curve, i.e. add df_bar * d(df)/dx to grad[x]
+    virtual double df(const Date& t, double df_bar, risk_gradient_t& grad) const = 0;
 };
 
 struct ICurveFXForward : ICurve
 {
     // compute the FX forward price of currency ccy1 deniminated in ccy2 for delivery at time t
     virtual double fwd(const Date& t) const = 0;
+
+    // compute the FX forward prices for n dates at once, without throwing: the forward price
+    // of a date out of the range of the underlying curves is NaN
+    virtual void fwd(const Date *t, double *out, size_t n) const = 0;
+
+    // compute the FX forward price for date t and propagate the adjoint fwd_bar = dV/d(fwd)
+    // to the risk factors of the curve, i.e. add fwd_bar * d(fwd)/dx to grad[x]
+    virtual double fwd(const Date& t, double fwd_bar, risk_gradient_t& grad) const = 0;
 };
 
 struct ICurveFXSpot : ICurve
@@ -43,6 +68,10 @@ struct ICurveFXSpot : ICurve
     // return the FX spot price of currency ccy1 deniminated in ccy2 for delivery at time t
     // ignore the fact that the FX spot is a t+2 forward price itself, and assume it is the istantaneous exchange rate
     virtual double spot() const = 0;
+
+    // return the FX spot price and propagate the adjoint spot_bar = dV/d(spot) to the
+    // risk factors of the curve, i.e. add spot_bar * d(spot)/dx to grad[x]
+    virtual double spot(double spot_bar, risk_gradient_t& grad) const = 0;
 };
 
 } // namespace minirisk
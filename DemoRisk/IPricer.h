@@ -10,6 +10,13 @@ namespace minirisk {
 struct IPricer : IObject
 {
     virtual double price(Market& m) const = 0;
+
+    // compute the price and add its sensitivities with respect to the risk factors to grad
+    // (hand-written adjoint of price), so that all first order risks come from a single pass
+    virtual double price_with_gradient(Market& m, risk_gradient_t& grad) const
+    {
+        NOT_IMPLEMENTED;
+    }
 };
 
 
@@ -1,120 +1,420 @@
 #include "Market.h"
 #include "CurveDiscount.h"
+#include "CurveFXForward.h"
+#include "CurveFXSpot.h"
+#include "Streamer.h"
+#include "Profiler.h"
 
 #include <vector>
+#include <algorithm>
 #include <limits>
+#include <cmath>
 
 namespace minirisk {
 
+// dependency recorder of the curve being built by the current thread
+static thread_local Market::risk_factor_deps_t *t_curve_deps = nullptr;
+
+template <typename T>
+ptr_curve_t Market::build_curve(symbol_t id, risk_factor_deps_t& deps)
+{
+    // record the risk factors read while building the curve
+    PROFILE_COUNT(profile_curve_builds);
+    risk_factor_deps_t *outer = t_curve_deps;
+    t_curve_deps = &deps;
+    ptr_curve_t curve;
+    try {
+        curve.reset(new T(this, m_today, symbol_name(id)));
+    }
+    catch (...) {
+        t_curve_deps = outer;
+        throw;
+    }
+    t_curve_deps = outer;
+    return curve;
+}
+
+// a discount curve only depending on a modified IR risk factor is bumped on one pillar
+template <>
+ptr_curve_t Market::bump_base_curve<CurveDiscount>(symbol_t id, risk_factor_deps_t& deps) const
+{
+    if (id >= m_base->m_curves.size() || !m_base->m_curves[id])
+        return nullptr;
+    const risk_factor_deps_t& base_deps = m_base->m_curve_deps[id];
+    const risk_factor_t *bump = nullptr;
+    for (const auto& rf : m_bumps) {
+        if (base_deps.count(rf.first)) {
+            if (bump)
+                return nullptr; // more than one modified risk factor
+            bump = &rf;
+        }
+    }
+    const CurveDiscount *base = dynamic_cast<const CurveDiscount *>(m_base->m_curves[id].get());
+    if (!bump || !base)
+        return nullptr;
+    ptr_curve_t res = base->bump(bump->first, bump->second);
+    if (res)
+        deps = base_deps;
+    return res;
+}
+
 template <typename I, typename T>
-std::shared_ptr<const I> Market::get_curve(const string& name)
+std::shared_ptr<const I> Market::get_curve(symbol_t id)
 {
-    ptr_curve_t& curve_ptr = m_curves[name];
-    if (!curve_ptr.get())
-        curve_ptr.reset(new T(this, m_today, name));
-    std::shared_ptr<const I> res = std::dynamic_pointer_cast<const I>(curve_ptr);
-    MYASSERT(res, "Cannot cast object with name " << name << " to type " << typeid(I).name());
+    const ptr_curve_t *curve_ptr = nullptr;
+    const risk_factor_deps_t *curve_deps = nullptr;
+
+    if (m_concurrent && id >= m_concurrent->m_size) {
+        // name interned after the market was made concurrent
+        auto& slot = m_concurrent->late_slot(m_concurrent->m_late_curves, id);
+        std::call_once(slot.m_flag, [&]() {
+            slot.m_curve = build_curve<T>(id, slot.m_deps);
+        });
+        curve_ptr = &slot.m_curve;
+        curve_deps = &slot.m_deps;
+    }
+    else if (m_concurrent) {
+        // the first thread requesting the curve builds it, the others wait for it
+        MarketSnapshot& base = *m_base;
+        std::call_once(m_concurrent->m_curves[id], [&]() {
+            if (!base.m_curves[id]) {
+                risk_factor_deps_t deps;
+                ptr_curve_t curve = build_curve<T>(id, deps);
+                base.m_curve_deps[id] = std::move(deps);
+                base.m_curves[id] = curve;
+            }
+        });
+        curve_ptr = &base.m_curves[id];
+        curve_deps = &base.m_curve_deps[id];
+    }
+    else {
+        // look for a curve built from the overlay first, then for a curve of the base snapshot
+        // which does not depend on any modified risk factor
+        for (const auto& c : m_overlay_curves) {
+            if (c.id == id) {
+                curve_ptr = &c.curve;
+                curve_deps = &c.deps;
+                break;
+            }
+        }
+        if (!curve_ptr && id < m_base->m_curves.size() && m_base->m_curves[id] && !bumped(m_base->m_curve_deps[id])) {
+            curve_ptr = &m_base->m_curves[id];
+            curve_deps = &m_base->m_curve_deps[id];
+        }
+    }
+
+    if (!curve_ptr) {
+        risk_factor_deps_t deps;
+        ptr_curve_t curve;
+        if (const cached_curve_t *cached = find_cached_curve(id)) {
+            PROFILE_COUNT(profile_curve_cache_hits);
+            curve = cached->curve;
+            deps = cached->deps;
+        }
+        else if ((curve = bump_base_curve<T>(id, deps)))
+            PROFILE_COUNT(profile_curve_bumps);
+        else
+            curve = build_curve<T>(id, deps);
+
+        if (owns_base()) {
+            MarketSnapshot& base = *m_base;
+            if (id >= base.m_curves.size()) {
+                base.m_curves.resize(symbol_count());
+                base.m_curve_deps.resize(symbol_count());
+            }
+            base.m_curves[id] = curve;
+            base.m_curve_deps[id] = std::move(deps);
+            curve_ptr = &base.m_curves[id];
+            curve_deps = &base.m_curve_deps[id];
+        }
+        else {
+            m_overlay_curves.push_back(overlay_curve_t{ id, curve, std::move(deps) });
+            curve_ptr = &m_overlay_curves.back().curve;
+            curve_deps = &m_overlay_curves.back().deps;
+        }
+    }
+
+    if (t_curve_deps)
+        t_curve_deps->insert(curve_deps->begin(), curve_deps->end());
+    if (m_deps)
+        m_deps->insert(curve_deps->begin(), curve_deps->end());
+    std::shared_ptr<const I> res = std::dynamic_pointer_cast<const I>(*curve_ptr);
+    MYASSERT(res, "Cannot cast object with name " << symbol_name(id) << " to type " << typeid(I).name());
     return res;
 }
 
-const ptr_disc_curve_t Market::get_discount_curve(const string& name)
+double Market::value(symbol_t id) const
 {
-    return get_curve<ICurveDiscount, CurveDiscount>(name);
+    auto iter = std::lower_bound(m_bumps.begin(), m_bumps.end(), id
+        , [](const risk_factor_t& rf, symbol_t i) { return rf.first < i; });
+    if (iter != m_bumps.end() && iter->first == id)
+        return iter->second;
+    return id < m_base->m_risk_factors.size() ? m_base->m_risk_factors[id] : std::numeric_limits<double>::quiet_NaN();
 }
 
-double Market::from_mds(const string& objtype, const string& name)
+void Market::retire_curve(symbol_t id, const ptr_curve_t& curve, const risk_factor_deps_t& deps)
 {
-    auto ins = m_risk_factors.emplace(name, std::numeric_limits<double>::quiet_NaN());
-    if (ins.second) { // just inserted, need to be populated
-        MYASSERT(m_mds, "Cannot fetch " << objtype << " " << name << " because the market data server has been disconnnected");
-        ins.first->second = m_mds->get(name);
-    }
-    return ins.first->second;
-}
-
-unsigned Market::to_days(const string& key, const string& ccyname)
-{
-    unsigned unit=0, period=0, extra_length;
-    extra_length = ir_rate_prefix.length() + ccyname.length() + 1; // 1 is for the '.' before ccy
-    string middle_part = key.substr(ir_rate_prefix.length(), key.length()-extra_length); // keep as '10W'
-    char c = middle_part.back(); // 'W'
-    middle_part.pop_back();
-    unit = std::stoi(middle_part); // 10
-    switch (c)
-    {
-    case 'D':
-        period = 1;
-        break;
-    case 'W':
-        period = 7;
-        break;
-    case 'M':
-        period = 30;
-        break;
-    case 'Y':
-        period = 365;
-        break;
-    default:
-        MYASSERT(false, "Please input D/W/M/Y to get the yield curve.");
-        break;
+    if (m_curve_cache.size() == curve_cache_size)
+        m_curve_cache.erase(m_curve_cache.begin());
+    cached_curve_t c{ id, curve, deps, std::vector<double>() };
+    c.values.reserve(deps.size());
+    for (symbol_t rf : deps)
+        c.values.push_back(value(rf));
+    m_curve_cache.push_back(std::move(c));
+}
+
+const Market::cached_curve_t *Market::find_cached_curve(symbol_t id) const
+{
+    // most recently destroyed curves first
+    for (auto iter = m_curve_cache.rbegin(); iter != m_curve_cache.rend(); ++iter) {
+        if (iter->id != id)
+            continue;
+        size_t i = 0;
+        for (symbol_t rf : iter->deps) {
+            if (value(rf) != iter->values[i])
+                break;
+            ++i;
+        }
+        if (i == iter->values.size())
+            return &*iter;
     }
+    return nullptr;
+}
+
+bool Market::bumped(const risk_factor_deps_t& deps) const
+{
+    for (const auto& rf : m_bumps)
+        if (deps.count(rf.first))
+            return true;
+    return false;
+}
+
+MarketSnapshot& Market::own_base()
+{
+    if (m_base.use_count() > 1)
+        m_base = std::make_shared<MarketSnapshot>(*m_base);
+    return *m_base;
+}
 
-    return unit * period;
+void Market::clear()
+{
+    merge_late_slots();
+    m_overlay_curves.clear();
+    m_curve_cache.clear();
+    MarketSnapshot& base = own_base();
+    std::for_each(base.m_curves.begin(), base.m_curves.end(), [](auto& p) { p.reset(); });
+    if (m_concurrent)
+        set_concurrent(true);
 }
 
-const std::map<unsigned, double> Market::get_yield(const string& ccyname)
+void Market::merge_late_slots()
 {
-    string expr = ir_rate_prefix + "\\d+[DWMY]." + ccyname;
-    
-    std::map<unsigned, double> yield_curve = {{0, 0.0}};
-    unsigned t;
-    if (m_mds)
-    {
-        std::vector<std::string> matched_keys = m_mds->match(expr);
-        for (const string& key : matched_keys)
-        {
-            t = to_days(key, ccyname);
-            yield_curve.emplace(t, t * from_mds("yield curve", key)/365.0);
+    if (!m_concurrent || (m_concurrent->m_late_curves.empty() && m_concurrent->m_late_risk_factors.empty()))
+        return;
+    MarketSnapshot& base = *m_base;
+    size_t n = symbol_count();
+    base.m_risk_factors.resize(std::max(n, base.m_risk_factors.size()), std::numeric_limits<double>::quiet_NaN());
+    base.m_curves.resize(std::max(n, base.m_curves.size()));
+    base.m_curve_deps.resize(std::max(n, base.m_curve_deps.size()));
+    for (auto& rf : m_concurrent->m_late_risk_factors)
+        if (!std::isnan(rf.second.m_value))
+            base.m_risk_factors[rf.first] = rf.second.m_value;
+    for (auto& c : m_concurrent->m_late_curves) {
+        if (c.second.m_curve) {
+            base.m_curves[c.first] = std::move(c.second.m_curve);
+            base.m_curve_deps[c.first] = std::move(c.second.m_deps);
         }
     }
-    else
-    {
-        std::regex r(expr);
-        for (const auto& rf : m_risk_factors)
-        {
-            if (std::regex_match(rf.first, r))
-            {
-                t = to_days(rf.first, ccyname);
-                yield_curve.emplace(t, t * from_mds("yield curve", rf.first)/365.0);
+    m_concurrent->m_late_risk_factors.clear();
+    m_concurrent->m_late_curves.clear();
+}
+
+void Market::set_concurrent(bool concurrent)
+{
+    merge_late_slots();
+    if (!concurrent) {
+        m_concurrent.reset();
+        return;
+    }
+    MYASSERT(can_be_concurrent(), "A market can be made concurrent only if it owns its base snapshot and has no bumps");
+
+    // slots are allocated upfront for all symbols known so far, so that they are never reallocated.
+    // Flags are recreated from scratch, as some curves might have been invalidated since they were built.
+    MarketSnapshot& base = *m_base;
+    size_t n = symbol_count();
+    base.m_risk_factors.resize(std::max(n, base.m_risk_factors.size()), std::numeric_limits<double>::quiet_NaN());
+    base.m_curves.resize(std::max(n, base.m_curves.size()));
+    base.m_curve_deps.resize(std::max(n, base.m_curve_deps.size()));
+    m_concurrent.reset(new concurrent_t(n));
+}
+
+const ptr_disc_curve_t Market::get_discount_curve(symbol_t id)
+{
+    return get_curve<ICurveDiscount, CurveDiscount>(id);
+}
+
+const ptr_fwd_curve_t Market::get_fx_forward_curve(symbol_t id)
+{
+    return get_curve<ICurveFXForward, CurveFXForward>(id);
+}
+
+const ptr_fx_spot_curve_t Market::get_fx_spot_curve(symbol_t id)
+{
+    return get_curve<ICurveFXSpot, CurveFXSpot>(id);
+}
+
+double Market::get_fixing(symbol_t id, const Date& t) const
+{
+    MYASSERT(m_fds, "Fixing not found: " << symbol_name(id) << "," << t);
+    return m_fds->get(id, t);
+}
+
+double Market::from_mds(const char *objtype, symbol_t id)
+{
+    double v;
+    if (m_concurrent && id >= m_concurrent->m_size) {
+        // name interned after the market was made concurrent
+        auto& slot = m_concurrent->late_slot(m_concurrent->m_late_risk_factors, id);
+        std::call_once(slot.m_flag, [&]() {
+            MYASSERT(m_mds, "Cannot fetch " << objtype << " " << symbol_name(id) << " because the market data server has been disconnnected");
+            PROFILE_COUNT(profile_mds_fetches);
+            slot.m_value = m_mds->get(id);
+            std::lock_guard<std::mutex> lock(m_concurrent->m_index_mutex);
+            m_base->m_index.insert(id);
+        });
+        v = slot.m_value;
+    }
+    else if (m_concurrent) {
+        // the first thread requesting the risk factor fetches it, the others wait for it
+        MarketSnapshot& base = *m_base;
+        std::call_once(m_concurrent->m_risk_factors[id], [&]() {
+            if (std::isnan(base.m_risk_factors[id])) {
+                MYASSERT(m_mds, "Cannot fetch " << objtype << " " << symbol_name(id) << " because the market data server has been disconnnected");
+                PROFILE_COUNT(profile_mds_fetches);
+                base.m_risk_factors[id] = m_mds->get(id);
+                std::lock_guard<std::mutex> lock(m_concurrent->m_index_mutex);
+                base.m_index.insert(id);
             }
+        });
+        v = base.m_risk_factors[id];
+    }
+    else {
+        v = value(id);
+        if (std::isnan(v)) { // not fetched yet, need to be populated
+            MYASSERT(m_mds, "Cannot fetch " << objtype << " " << symbol_name(id) << " because the market data server has been disconnnected");
+            PROFILE_COUNT(profile_mds_fetches);
+            v = m_mds->get(id);
+            // a new risk factor does not affect any existing curve, hence it can be added to the base
+            MarketSnapshot& base = own_base();
+            if (id >= base.m_risk_factors.size())
+                base.m_risk_factors.resize(symbol_count(), std::numeric_limits<double>::quiet_NaN());
+            base.m_risk_factors[id] = v;
+            base.m_index.insert(id);
         }
     }
-    
+    if (t_curve_deps)
+        t_curve_deps->insert(id);
+    if (m_deps)
+        m_deps->insert(id);
+    return v;
+}
+
+const Market::yield_curve_t Market::get_yield(const string& ccyname)
+{
+    yield_curve_t yield_curve = {{0, {0.0, null_symbol}}};
+    const RiskFactorIndex& index = m_mds ? m_mds->index() : m_base->m_index;
+    for (const auto& rf : index.ir_rates(ccyname))
+        yield_curve.emplace(rf.first, std::make_pair(rf.first * from_mds("yield curve", rf.second) / 365.0, rf.second));
     return yield_curve;
-};
+}
 
-const double Market::get_fx_spot(const string& name)
+const double Market::get_fx_spot(symbol_t spot)
 {
-    return from_mds("fx spot", mds_spot_name(name));
+    return from_mds("fx spot", spot);
 }
 
 void Market::set_risk_factors(const vec_risk_factor_t& risk_factors)
 {
-    clear();
+    merge_late_slots();
     for (const auto& d : risk_factors) {
-        auto i = m_risk_factors.find(d.first);
-        MYASSERT((i != m_risk_factors.end()), "Risk factor not found " << d.first);
-        i->second = d.second;
+        const std::vector<double>& base_values = m_base->m_risk_factors;
+        MYASSERT((d.first < base_values.size() && !std::isnan(base_values[d.first])), "Risk factor not found " << symbol_name(d.first));
+
+        // nothing to destroy if the value does not change
+        if (value(d.first) == d.second)
+            continue;
+
+        // only the curves built from the modified data point need to be destroyed, they are
+        // retired into the cache before the value changes
+        for (const auto& c : m_overlay_curves)
+            if (c.deps.count(d.first))
+                retire_curve(c.id, c.curve, c.deps);
+        m_overlay_curves.erase(std::remove_if(m_overlay_curves.begin(), m_overlay_curves.end()
+            , [&d](const overlay_curve_t& c) { return c.deps.count(d.first) > 0; }), m_overlay_curves.end());
+
+        if (owns_base()) {
+            for (size_t c = 0; c < m_base->m_curves.size(); ++c) {
+                if (m_base->m_curves[c] && m_base->m_curve_deps[c].count(d.first)) {
+                    if (!m_concurrent)
+                        retire_curve(static_cast<symbol_t>(c), m_base->m_curves[c], m_base->m_curve_deps[c]);
+                    m_base->m_curves[c].reset();
+                }
+            }
+            m_base->m_risk_factors[d.first] = d.second;
+        }
+        else {
+            // the base is shared: record the new value in the overlay, or drop it from the overlay
+            // if the base value is restored. Curves of the base depending on a modified risk
+            // factor are ignored by get_curve.
+            auto iter = std::lower_bound(m_bumps.begin(), m_bumps.end(), d.first
+                , [](const risk_factor_t& rf, symbol_t i) { return rf.first < i; });
+            bool found = iter != m_bumps.end() && iter->first == d.first;
+            if (d.second == base_values[d.first]) {
+                if (found)
+                    m_bumps.erase(iter);
+            }
+            else if (found)
+                iter->second = d.second;
+            else
+                m_bumps.insert(iter, d);
+        }
     }
+
+    // invalidated curves must be built again
+    if (m_concurrent)
+        set_concurrent(true);
 }
 
 Market::vec_risk_factor_t Market::get_risk_factors(const std::string& expr) const
 {
+    // sort by name
+    std::map<string, symbol_t> names;
+    for (symbol_t id = 0; id < m_base->m_risk_factors.size(); ++id)
+        if (!std::isnan(m_base->m_risk_factors[id]))
+            names.emplace(symbol_name(id), id);
+
     vec_risk_factor_t result;
     std::regex r(expr);
-    for (const auto& d : m_risk_factors)
+    PROFILE_ADD(profile_regex_matches, names.size());
+    for (const auto& d : names)
         if (std::regex_match(d.first, r))
-            result.push_back(d);
+            result.emplace_back(d.second, value(d.second));
+    return result;
+}
+
+Market::vec_risk_factor_t Market::get_risk_factors(RiskFactorKey::asset_class_t asset_class) const
+{
+    vec_risk_factor_t result;
+    for (symbol_t id : m_base->m_index.symbols(asset_class))
+        result.emplace_back(id, value(id));
+    return result;
+}
+
+Market::vec_risk_factor_t Market::get_ir_risk_factors(const string& ccy) const
+{
+    vec_risk_factor_t result;
+    for (const auto& rf : m_base->m_index.ir_rates(ccy))
+        result.emplace_back(rf.second, value(rf.second));
     return result;
 }
 
@@ -4,43 +4,144 @@
 #include "IObject.h"
 #include "ICurve.h"
 #include "MarketDataServer.h"
+#include "FixingDataServer.h"
+#include "RiskFactorIndex.h"
+#include "SymbolTable.h"
 #include <vector>
+#include <set>
+#include <map>
+#include <limits>
 #include <regex>
+#include <mutex>
 
 namespace minirisk {
 
+// State of a market which can be shared by several Market objects: the risk factors fetched
+// so far and the curves built from them.
+// A snapshot referred to by more than one Market object is never modified (copy-on-write).
+struct MarketSnapshot
+{
+    // raw risk factors, indexed by their interned name (NaN if not fetched yet)
+    std::vector<double> m_risk_factors;
+
+    // structured index of the raw risk factors
+    RiskFactorIndex m_index;
+
+    // market curves, indexed by their interned name
+    std::vector<ptr_curve_t> m_curves;
+
+    // risk factors used to build each market curve
+    std::vector<std::set<symbol_t>> m_curve_deps;
+};
+
+// A Market is a shared base snapshot plus a small overlay of modified risk factors and of the
+// curves built from them. Copying a Market only copies the overlay, so scenario markets are
+// created in O(bumps) time and memory, and markets used by different threads share the base.
 struct Market : IObject
 {
 private:
-    // NOTE: this function is not thread safe
+    // NOTE: this function is thread safe only in concurrent mode (see set_concurrent)
     template <typename I, typename T>
-    std::shared_ptr<const I> get_curve(const string& name);
-
-    double from_mds(const string& objtype, const string& name);
+    std::shared_ptr<const I> get_curve(symbol_t id);
 
-    unsigned to_days(const string &key, const string &ccyname);
+    double from_mds(const char *objtype, symbol_t id);
 
 public:
 
-    typedef std::pair<string, double> risk_factor_t;
-    typedef std::vector<std::pair<string, double>> vec_risk_factor_t;
+    // risk factors are identified by their interned name
+    typedef std::pair<symbol_t, double> risk_factor_t;
+    typedef std::vector<risk_factor_t> vec_risk_factor_t;
+    typedef std::set<symbol_t> risk_factor_deps_t;
+
+    // yield curve pillars: number of days -> (r * t, IR risk factor)
+    typedef std::map<unsigned, std::pair<double, symbol_t>> yield_curve_t;
 
-    Market(const std::shared_ptr<const MarketDataServer>& mds, const Date& today)
+    Market(const std::shared_ptr<const MarketDataServer>& mds, const Date& today
+        , const std::shared_ptr<const FixingDataServer>& fds = nullptr)
         : m_today(today)
         , m_mds(mds)
+        , m_fds(fds)
+        , m_base(new MarketSnapshot)
+    {
+    }
+
+    // the copy shares the base snapshot, but is never in concurrent mode and does not record
+    // dependencies into the recorder of m
+    Market(const Market& m)
+        : m_today(m.m_today)
+        , m_mds(m.m_mds)
+        , m_fds(m.m_fds)
+        , m_base(m.m_base)
+        , m_bumps(m.m_bumps)
+        , m_overlay_curves(m.m_overlay_curves)
+        , m_curve_cache(m.m_curve_cache)
     {
     }
 
     virtual Date today() const { return m_today; }
 
+    // In concurrent mode the market can be used to price from several threads at once: each
+    // curve is built at most once and each risk factor is fetched at most once. Names interned
+    // after the market was made concurrent are supported, through a slower mutex protected
+    // lookup of their slots, and are merged into the base snapshot when leaving concurrent mode.
+    // The market must own its base snapshot and have no bumps. While in concurrent mode,
+    // dependencies must not be recorded, and set_risk_factors, clear and disconnect must not
+    // be called concurrently with pricing.
+    void set_concurrent(bool concurrent);
+
+    bool concurrent() const { return m_concurrent != nullptr; }
+
+    // true if set_concurrent(true) can be called
+    bool can_be_concurrent() const
+    {
+        return owns_base() && m_overlay_curves.empty();
+    }
+
     // get an object of type ICurveDisocunt
-    const ptr_disc_curve_t get_discount_curve(const string& name);
+    const ptr_disc_curve_t get_discount_curve(const string& name)
+    {
+        return get_discount_curve(intern(name));
+    }
+    const ptr_disc_curve_t get_discount_curve(symbol_t id);
+
+    // get an object of type ICurveFXForward
+    const ptr_fwd_curve_t get_fx_forward_curve(const string& name)
+    {
+        return get_fx_forward_curve(intern(name));
+    }
+    const ptr_fwd_curve_t get_fx_forward_curve(symbol_t id);
+
+    // get an object of type ICurveFXSpot (e.g. FX.SPOT.EUR.GBP), where cross rates are
+    // computed once and cached like any other curve
+    const ptr_fx_spot_curve_t get_fx_spot_curve(const string& name)
+    {
+        return get_fx_spot_curve(intern(name));
+    }
+    const ptr_fx_spot_curve_t get_fx_spot_curve(symbol_t id);
 
     // yield rate for currency name
-    const std::map<unsigned, double> get_yield(const string& name);
+    const yield_curve_t get_yield(const string& name);
 
     // fx exchange rate to convert 1 unit of ccy1 into USD
-    const double get_fx_spot(const string& ccy);
+    const double get_fx_spot(const string& name)
+    {
+        return get_fx_spot(intern(mds_spot_name(name)));
+    }
+    // same as above, where spot is the interned name of the risk factor (e.g. FX.SPOT.EUR)
+    const double get_fx_spot(symbol_t spot);
+
+    // historical fixing of id (e.g. FX.SPOT.EUR.USD) at date t.
+    // Fixings are not risk factors: they are not recorded as dependencies and they are still
+    // available after the market has been disconnected.
+    double get_fixing(symbol_t id, const Date& t) const;
+
+    // same as above, without throwing if the fixing is not available (the value is then NaN)
+    std::pair<double, bool> lookup_fixing(symbol_t id, const Date& t) const
+    {
+        return m_fds
+            ? m_fds->lookup(id, t)
+            : std::make_pair(std::numeric_limits<double>::quiet_NaN(), false);
+    }
 
     // after the market has been disconnected, it is no more possible to fetch
     // new data points from the market data server
@@ -52,25 +153,183 @@ public:
     // returns risk factors matching a regular expression
     vec_risk_factor_t get_risk_factors(const std::string& expr) const;
 
-    // clear all market curves execpt for the data points
-    void clear()
+    // returns all risk factors of a given asset class, sorted by name
+    vec_risk_factor_t get_risk_factors(RiskFactorKey::asset_class_t asset_class) const;
+
+    // returns the currencies having at least one risk factor of a given asset class
+    std::set<string> get_currencies(RiskFactorKey::asset_class_t asset_class) const
     {
-        std::for_each(m_curves.begin(), m_curves.end(), [](auto& p) { p.second.reset(); });
+        return m_base->m_index.currencies(asset_class);
     }
 
-    // destroy all existing objects and modify a selected number of data points
+    // returns the IR rates of currency ccy, sorted by tenor
+    vec_risk_factor_t get_ir_risk_factors(const string& ccy) const;
+
+    // clear all market curves execpt for the data points
+    void clear();
+
+    // Destroy the objects depending on a selected number of data points and modify them.
+    // Data points set to their current value do not destroy anything. Destroyed curves are kept
+    // in a small cache keyed by the values of the risk factors they were built from, so that
+    // they are reused when these values are restored.
     void set_risk_factors(const vec_risk_factor_t& risk_factors);
 
+    // while deps is not null, all risk factors read from the market, either
+    // directly or through a curve, are recorded into deps
+    void record_dependencies(risk_factor_deps_t *deps)
+    {
+        m_deps = deps;
+    }
+
 private:
+    // a curve built from the overlay
+    struct overlay_curve_t
+    {
+        symbol_t id;
+        ptr_curve_t curve;
+        risk_factor_deps_t deps;
+    };
+
+    // a destroyed curve, with the values of the risk factors it was built from (in the order of deps)
+    struct cached_curve_t
+    {
+        symbol_t id;
+        ptr_curve_t curve;
+        risk_factor_deps_t deps;
+        std::vector<double> values;
+    };
+
+    // maximum number of curves in m_curve_cache
+    static const size_t curve_cache_size = 64;
+
+    // value of a risk factor, taking into account the overlay (NaN if not fetched yet)
+    double value(symbol_t id) const;
+
+    // move a curve about to be destroyed into the cache, with the current values of its inputs
+    void retire_curve(symbol_t id, const ptr_curve_t& curve, const risk_factor_deps_t& deps);
+
+    // a curve of the cache built from the current values of its inputs, or null
+    const cached_curve_t *find_cached_curve(symbol_t id) const;
+
+    // true if deps contains a risk factor modified in the overlay
+    bool bumped(const risk_factor_deps_t& deps) const;
+
+    // true if the base snapshot can be modified in place
+    bool owns_base() const
+    {
+        return m_bumps.empty() && m_base.use_count() == 1;
+    }
+
+    // make the base snapshot exclusively owned by this market, copying it if it is shared
+    MarketSnapshot& own_base();
+
+    // build curve id of type T, recording the risk factors it depends on into deps
+    template <typename T>
+    ptr_curve_t build_curve(symbol_t id, risk_factor_deps_t& deps);
+
+    // Derive curve id of type T from the curve of the base snapshot, if the type supports it
+    // and a single risk factor it depends on is modified in the overlay, without going through
+    // the market data. Returns null otherwise.
+    template <typename T>
+    ptr_curve_t bump_base_curve(symbol_t id, risk_factor_deps_t& deps) const
+    {
+        return nullptr;
+    }
+
+    // per-slot synchronization of the lazy construction of the base snapshot in concurrent mode
+    struct concurrent_t
+    {
+        explicit concurrent_t(size_t n)
+            : m_size(n)
+            , m_curves(new std::once_flag[n])
+            , m_risk_factors(new std::once_flag[n])
+        {
+        }
+
+        // slots of the names interned after the market was made concurrent, which cannot be
+        // stored in the base snapshot without reallocating it
+        struct late_curve_t
+        {
+            std::once_flag m_flag;
+            ptr_curve_t m_curve;
+            risk_factor_deps_t m_deps;
+        };
+
+        struct late_risk_factor_t
+        {
+            std::once_flag m_flag;
+            double m_value = std::numeric_limits<double>::quiet_NaN();
+        };
+
+        // The mutex only protects the lookup of the slots, not their construction, so that a
+        // thread building a late curve never holds it while waiting for another slot.
+        // Map nodes are never moved, hence references to the slots remain valid.
+        template <typename T>
+        T& late_slot(std::map<symbol_t, T>& slots, symbol_t id)
+        {
+            std::lock_guard<std::mutex> lock(m_late_mutex);
+            return slots[id];
+        }
+
+        size_t m_size;
+        std::unique_ptr<std::once_flag[]> m_curves;
+        std::unique_ptr<std::once_flag[]> m_risk_factors;
+        std::mutex m_index_mutex;
+        std::mutex m_late_mutex;
+        std::map<symbol_t, late_curve_t> m_late_curves;
+        std::map<symbol_t, late_risk_factor_t> m_late_risk_factors;
+    };
+
+    // move the curves and risk factors of the late slots into the base snapshot
+    void merge_late_slots();
+
     Date m_today;
     std::shared_ptr<const MarketDataServer> m_mds;
+    std::shared_ptr<const FixingDataServer> m_fds;
+
+    // base snapshot, possibly shared with other markets
+    std::shared_ptr<MarketSnapshot> m_base;
+
+    // risk factors modified with respect to the base snapshot, sorted by id
+    vec_risk_factor_t m_bumps;
 
-    // market curves
-    std::map<string, ptr_curve_t> m_curves;
+    // curves which cannot be stored in the base snapshot
+    std::vector<overlay_curve_t> m_overlay_curves;
 
-    // raw risk factors
-    std::map<string, double> m_risk_factors;
+    // curves destroyed by set_risk_factors, oldest first (not used in concurrent mode)
+    std::vector<cached_curve_t> m_curve_cache;
+
+    // current dependency recorder (not owned)
+    risk_factor_deps_t *m_deps = nullptr;
+
+    // not null in concurrent mode
+    std::unique_ptr<concurrent_t> m_concurrent;
 };
 
-} // namespace minirisk
+// Puts a market in concurrent mode for the lifetime of the object, if possible and if it is
+// not concurrent already. The previous mode is restored on destruction.
+struct ConcurrentMarketScope
+{
+    ConcurrentMarketScope(Market& mkt)
+        : m_mkt(mkt)
+        , m_switched(!mkt.concurrent() && mkt.can_be_concurrent())
+    {
+        if (m_switched)
+            m_mkt.set_concurrent(true);
+    }
+
+    ~ConcurrentMarketScope()
+    {
+        if (m_switched)
+            m_mkt.set_concurrent(false);
+    }
+
+    // true if the market can be used from several threads at once
+    bool concurrent() const { return m_mkt.concurrent(); }
 
+private:
+    Market& m_mkt;
+    bool m_switched;
+};
+
+} // namespace minirisk
@@ -1,8 +1,10 @@
 #include "MarketDataServer.h"
 #include "Macros.h"
 #include "Streamer.h"
+#include "Profiler.h"
 
 #include <limits>
+#include <cmath>
 
 namespace minirisk {
 
@@ -19,28 +21,46 @@ MarketDataServer::MarketDataServer(const string& filename)
 {
     std::ifstream is(filename);
     MYASSERT(!is.fail(), "Could not open file " << filename);
+    std::map<string, symbol_t> names;
     do {
         string name;
         double value;
         is >> name >> value;
         //std::cout << name << " " << value << "\n";
-        auto ins = m_data.emplace(name, value);
-        MYASSERT(ins.second, "Duplicated risk factor: " << name);
+        symbol_t id = intern(name);
+        if (id >= m_data.size())
+            m_data.resize(id + 1, std::numeric_limits<double>::quiet_NaN());
+        MYASSERT(names.emplace(name, id).second, "Duplicated risk factor: " << name);
+        m_data[id] = value;
+        m_index.insert(id);
     } while (is);
+    for (const auto& n : names)
+        m_symbols.push_back(n.second);
 }
 
 double MarketDataServer::get(const string& name) const
 {
-    auto iter = m_data.find(name);
-    MYASSERT(iter != m_data.end(), "Market data not found: " << name);
-    return iter->second;
+    auto res = lookup(name);
+    MYASSERT(res.second, "Market data not found: " << name);
+    return res.first;
+}
+
+double MarketDataServer::get(symbol_t id) const
+{
+    auto res = lookup(id);
+    MYASSERT(res.second, "Market data not found: " << symbol_name(id));
+    return res.first;
 }
 
 std::pair<double, bool> MarketDataServer::lookup(const string& name) const
 {
-    auto iter = m_data.find(name);
-    return (iter != m_data.end())  // found?
-            ? std::make_pair(iter->second, true)
+    return lookup(find_symbol(name));
+}
+
+std::pair<double, bool> MarketDataServer::lookup(symbol_t id) const
+{
+    return (id < m_data.size() && !std::isnan(m_data[id]))  // found?
+            ? std::make_pair(m_data[id], true)
             : std::make_pair(std::numeric_limits<double>::quiet_NaN(), false);
 }
 
@@ -48,15 +68,16 @@ std::vector<std::string> MarketDataServer::match(const std::string& expr) const
 {
     std::regex r(expr);
     std::vector<std::string> matched_keys;
-    for (const auto& data : m_data)
+    PROFILE_ADD(profile_regex_matches, m_symbols.size());
+    for (symbol_t id : m_symbols)
     {
-        if(std::regex_match(data.first, r))
+        const string& name = symbol_name(id);
+        if(std::regex_match(name, r))
         {
-            matched_keys.push_back(data.first);
+            matched_keys.push_back(name);
         }
     }
     return matched_keys;
 }
 
 } // namespace minirisk
-
@@ -3,6 +3,8 @@
 #include <map>
 #include <regex>
 #include "Global.h"
+#include "RiskFactorIndex.h"
+#include "SymbolTable.h"
 
 namespace minirisk {
 
@@ -16,12 +18,20 @@ public:
 
     // queries
     double get(const string& name) const;
+    double get(symbol_t id) const;
     std::pair<double, bool> lookup(const string& name) const;
+    std::pair<double, bool> lookup(symbol_t id) const;
     std::vector<std::string> match(const std::string& expr) const;
 
+    // structured index of all available market data names
+    const RiskFactorIndex& index() const { return m_index; }
+
 private:
     // for simplicity, assumes market data can only have type double
-    std::map<string, double> m_data;
+    // values are indexed by the interned name, NaN means not available
+    std::vector<double> m_data;
+    std::vector<symbol_t> m_symbols;  // available market data, sorted by name
+    RiskFactorIndex m_index;
 };
 
 string mds_spot_name(const string& name);
@@ -0,0 +1,275 @@
+#include "PortfolioBatch.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+#include "ThreadPool.h"
+
+#include <map>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace minirisk {
+
+PortfolioBatch::PortfolioBatch(const portfolio_t& portfolio, const string& base_ccy)
+    : m_size(portfolio.size())
+{
+    std::map<string, size_t> payment_groups; // currency -> position in m_payments
+    std::map<string, std::vector<const TradeFXForward *>> fx_forwards;  // currency pair -> trades
+    std::map<const ITrade *, size_t> fx_forward_position;
+    for (size_t i = 0; i < portfolio.size(); ++i) {
+        const TradePayment *p = dynamic_cast<const TradePayment *>(portfolio[i].get());
+        const TradeFXForward *f = p ? nullptr : dynamic_cast<const TradeFXForward *>(portfolio[i].get());
+        if (p) {
+            auto ins = payment_groups.emplace(p->ccy(), m_payments.size());
+            if (ins.second) {
+                PaymentGroup g;
+                g.m_ir_curve = intern(ir_curve_discount_name(p->ccy()));
+                g.m_fx_spot = p->ccy() == base_ccy ? null_symbol : intern(fx_spot_name(p->ccy(), base_ccy));
+                m_payments.push_back(g);
+            }
+            PaymentGroup& g = m_payments[ins.first->second];
+            g.m_quantity.push_back(p->quantity());
+            g.m_delivery.push_back(p->delivery_date());
+            g.m_position.push_back(i);
+        }
+        else if (f) {
+            fx_forwards[fx_forward_name(f->base_ccy(), f->quote_ccy())].push_back(f);
+            fx_forward_position[f] = i;
+        }
+        else {
+            m_other_pricers.push_back(portfolio[i]->pricer(base_ccy));
+            m_other_position.push_back(i);
+        }
+    }
+
+    for (auto& pair : fx_forwards) {
+        std::vector<const TradeFXForward *>& trades = pair.second;
+        std::stable_sort(trades.begin(), trades.end()
+            , [](const TradeFXForward *a, const TradeFXForward *b) { return a->fixing_date() < b->fixing_date(); });
+
+        FXForwardGroup g;
+        const TradeFXForward *f = trades.front();
+        g.m_ids = intern_fx_forward(f->base_ccy(), f->quote_ccy());
+        g.m_fx_spot = f->quote_ccy() == base_ccy ? null_symbol : intern(fx_spot_name(f->quote_ccy(), base_ccy));
+        for (const TradeFXForward *t : trades) {
+            if (g.m_fixing_dates.empty() || !(g.m_fixing_dates.back() == t->fixing_date()))
+                g.m_fixing_dates.push_back(t->fixing_date());
+            g.m_fixing.push_back(g.m_fixing_dates.size() - 1);
+            g.m_quantity.push_back(t->quantity());
+            g.m_strike.push_back(t->strike());
+            g.m_settlement.push_back(t->settlement_date());
+            g.m_position.push_back(fx_forward_position[t]);
+        }
+        m_fx_forwards.push_back(std::move(g));
+    }
+}
+
+size_t PortfolioBatch::group_size(size_t g) const
+{
+    if (g < m_payments.size())
+        return m_payments[g].m_quantity.size();
+    g -= m_payments.size();
+    if (g < m_fx_forwards.size())
+        return m_fx_forwards[g].m_quantity.size();
+    return m_other_pricers.size();
+}
+
+void PortfolioBatch::price_range(Market& mkt, size_t g, size_t begin, size_t end, portfolio_values_t& prices, std::vector<double>& work) const
+{
+    if (g < m_payments.size()) {
+        price_payments(mkt, m_payments[g], begin, end, prices, work);
+        return;
+    }
+    g -= m_payments.size();
+    if (g < m_fx_forwards.size()) {
+        price_fx_forwards(mkt, m_fx_forwards[g], begin, end, prices, work);
+        return;
+    }
+    for (size_t i = begin; i < end; ++i)
+        prices[m_other_position[i]] = price_trade(*m_other_pricers[i], mkt);
+}
+
+void PortfolioBatch::price_payments(Market& mkt, const PaymentGroup& grp, size_t begin, size_t end, portfolio_values_t& prices, std::vector<double>& df) const
+{
+    const size_t n = end - begin;
+    const size_t *pos = grp.m_position.data() + begin;
+
+    // market objects shared by the whole group: if not available, no trade can be priced
+    ptr_disc_curve_t disc;
+    double fx;
+    try {
+        disc = mkt.get_discount_curve(grp.m_ir_curve);
+        fx = (grp.m_fx_spot != null_symbol) ? mkt.get_fx_spot_curve(grp.m_fx_spot)->spot() : 1.0;
+    }
+    catch (const std::exception& e) {
+        for (size_t i = 0; i < n; ++i)
+            prices[pos[i]] = trade_error(e.what());
+        return;
+    }
+
+    // same operations as in PricerPayment::price, so that results are identical
+    df.resize(n);
+    disc->df(grp.m_delivery.data() + begin, df.data(), n);
+    const double *q = grp.m_quantity.data() + begin;
+    double *v = df.data();
+    for (size_t i = 0; i < n; ++i)
+        v[i] = q[i] * (v[i] * fx);
+    for (size_t i = 0; i < n; ++i) {
+        if (std::isnan(v[i])) {
+            // delivery date out of the curve range or invalid trade data: the scalar version
+            // reports the error
+            try {
+                prices[pos[i]] = checked_trade_value(q[i] * (disc->df(grp.m_delivery[begin + i]) * fx));
+            }
+            catch (const std::exception& e) {
+                prices[pos[i]] = trade_error(e.what());
+            }
+        }
+        else
+            prices[pos[i]] = trade_value(v[i]);
+    }
+}
+
+void PortfolioBatch::price_fx_forwards(Market& mkt, const FXForwardGroup& grp, size_t begin, size_t end, portfolio_values_t& prices, std::vector<double>& work) const
+{
+    const size_t n = end - begin;
+    const size_t *pos = grp.m_position.data() + begin;
+    const Date today = mkt.today();
+
+    // fixing dates which use the historical fixing rather than the forward curve: all dates before
+    // today, and today if its fixing is already published (same rule as in PricerFXForward)
+    const bool fixed_today = mkt.lookup_fixing(grp.m_ids.fx_spot, today).second;
+    auto fixed = [&](const Date& t) { return t < today || (fixed_today && t == today); };
+
+    // market objects shared by the whole group, the errors are reported in the same order as
+    // in PricerFXForward::price
+    ptr_disc_curve_t disc;
+    ptr_fwd_curve_t fwd_curve;
+    double fx = 1.0;
+    string disc_error, fwd_error, fx_error;
+    try {
+        disc = mkt.get_discount_curve(grp.m_ids.disc2);
+    }
+    catch (const std::exception& e) {
+        disc_error = e.what();
+    }
+    try {
+        if (!fixed(grp.m_fixing_dates[grp.m_fixing[end - 1]]))
+            fwd_curve = mkt.get_fx_forward_curve(grp.m_ids.fwd_curve);
+    }
+    catch (const std::exception& e) {
+        fwd_error = e.what();
+    }
+    try {
+        if (grp.m_fx_spot != null_symbol)
+            fx = mkt.get_fx_spot_curve(grp.m_fx_spot)->spot();
+    }
+    catch (const std::exception& e) {
+        fx_error = e.what();
+    }
+    if (!disc_error.empty()) {
+        for (size_t i = 0; i < n; ++i)
+            prices[pos[i]] = trade_error(disc_error);
+        return;
+    }
+
+    // forward rates, evaluated once per distinct fixing date of the range (trades are sorted by
+    // fixing date, hence the fixing dates of the range are contiguous)
+    const size_t f_begin = grp.m_fixing[begin];
+    const size_t f_end = grp.m_fixing[end - 1] + 1;
+    const size_t nf = f_end - f_begin;
+    work.resize(n + nf);
+    double *df = work.data();
+    double *fwd = work.data() + n;
+    const Date *fixing_dates = grp.m_fixing_dates.data() + f_begin;
+    const size_t f_past = std::partition_point(fixing_dates, fixing_dates + nf, fixed) - fixing_dates;
+    for (size_t j = 0; j < f_past; ++j)
+        fwd[j] = mkt.lookup_fixing(grp.m_ids.fx_spot, fixing_dates[j]).first;
+    if (fwd_curve)
+        fwd_curve->fwd(fixing_dates + f_past, fwd + f_past, nf - f_past);
+
+    // same operations as in PricerFXForward::price, so that results are identical
+    disc->df(grp.m_settlement.data() + begin, df, n);
+    const double *q = grp.m_quantity.data() + begin;
+    const double *k = grp.m_strike.data() + begin;
+    const size_t *f = grp.m_fixing.data() + begin;
+
+    // scalar version, with the same checks in the same order as in PricerFXForward::price, used
+    // to report the error of a trade which cannot be priced in batch
+    auto price_scalar = [&](size_t i, size_t j) -> trade_value_t {
+        try {
+            double d = disc->df(grp.m_settlement[begin + i]);
+            double w;
+            if (j < f_past)
+                w = mkt.get_fixing(grp.m_ids.fx_spot, fixing_dates[j]);
+            else if (!fwd_error.empty())
+                return trade_error(fwd_error);
+            else
+                w = fwd_curve->fwd(fixing_dates[j]);
+            if (!fx_error.empty())
+                return trade_error(fx_error);
+            return checked_trade_value(q[i] * ((w - k[i]) * (d * fx)));
+        }
+        catch (const std::exception& e) {
+            return trade_error(e.what());
+        }
+    };
+
+    for (size_t i = 0; i < n; ++i) {
+        const size_t j = f[i] - f_begin;
+        if ((j >= f_past && !fwd_error.empty()) || !fx_error.empty()) {
+            prices[pos[i]] = price_scalar(i, j);
+            continue;
+        }
+        // settlement date out of the curve range, historical fixing not available or invalid
+        // trade data: the scalar version reports the error
+        const double v = q[i] * ((fwd[j] - k[i]) * (df[i] * fx));
+        prices[pos[i]] = std::isnan(v) ? price_scalar(i, j) : trade_value(v);
+    }
+}
+
+portfolio_values_t PortfolioBatch::price(Market& mkt) const
+{
+    portfolio_values_t prices(m_size);
+    std::vector<double> work;
+
+    for (size_t g = 0, n = m_payments.size() + m_fx_forwards.size() + 1; g < n; ++g)
+        price_range(mkt, g, 0, group_size(g), prices, work);
+
+    return prices;
+}
+
+portfolio_values_t PortfolioBatch::price(Market& mkt, ThreadPool& pool) const
+{
+    if (pool.size() == 1)
+        return price(mkt);
+
+    ConcurrentMarketScope scope(mkt);
+    if (!scope.concurrent())
+        return price(mkt);
+
+    // split all groups into chunks
+    struct chunk_t
+    {
+        size_t group;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<chunk_t> chunks;
+    for (size_t g = 0, n = m_payments.size() + m_fx_forwards.size() + 1; g < n; ++g) {
+        const size_t size = group_size(g);
+        for (size_t b = 0; b < size; b += price_chunk_size)
+            chunks.push_back(chunk_t{ g, b, std::min(size, b + price_chunk_size) });
+    }
+
+    portfolio_values_t prices(m_size);
+    pool.parallel_for(chunks.size(), 1, [&](size_t begin, size_t end, unsigned) {
+        std::vector<double> work;
+        for (size_t c = begin; c < end; ++c)
+            price_range(mkt, chunks[c].group, chunks[c].begin, chunks[c].end, prices, work);
+    });
+
+    return prices;
+}
+
+} // namespace minirisk
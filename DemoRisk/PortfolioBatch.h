@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "ITrade.h"
+#include "IPricer.h"
+#include "PortfolioUtils.h"
+#include "CurveFXForward.h"
+
+namespace minirisk {
+
+// Payments sharing the same currency, hence the same discount curve and FX spot.
+// Trade attributes are stored in contiguous arrays (struct of arrays).
+struct PaymentGroup
+{
+    symbol_t m_ir_curve;
+    symbol_t m_fx_spot;               // FX spot in the base currency, null_symbol if no conversion is needed
+    std::vector<double> m_quantity;
+    std::vector<Date>   m_delivery;
+    std::vector<size_t> m_position;   // position of each trade in the portfolio
+};
+
+// FX forwards sharing the same currency pair, hence the same forward curve, discount curve and
+// FX spot. Trades are sorted by fixing date, and the forward rate is evaluated once per distinct
+// fixing date.
+struct FXForwardGroup
+{
+    fx_forward_ids_t m_ids;           // forward curve, and the curves and the FX pair fixing it depends on
+    symbol_t m_fx_spot;               // FX spot of the quote currency in the base currency, null_symbol if no conversion is needed
+    std::vector<Date>   m_fixing_dates;  // distinct fixing dates, sorted
+    std::vector<size_t> m_fixing;        // index in m_fixing_dates of the fixing date of each trade
+    std::vector<double> m_quantity;
+    std::vector<double> m_strike;
+    std::vector<Date>   m_settlement;
+    std::vector<size_t> m_position;   // position of each trade in the portfolio
+};
+
+// Columnar representation of a portfolio, where homogeneous trades are grouped together and
+// priced with tight loops over the group arrays instead of one virtual call per trade.
+// Trades of types not supported by the batch pricer are priced individually by their own pricer.
+struct PortfolioBatch
+{
+    // prices are computed in currency base_ccy
+    PortfolioBatch(const portfolio_t& portfolio, const string& base_ccy);
+
+    // compute prices, in the same order as the trades in the portfolio
+    portfolio_values_t price(Market& mkt) const;
+
+    // same as above, where chunks of the groups are priced in parallel over the threads of pool,
+    // if the market can be made concurrent
+    portfolio_values_t price(Market& mkt, ThreadPool& pool) const;
+
+    size_t size() const { return m_size; }
+
+private:
+    // Price the trades in [begin, end) of group g, where groups are numbered as the payment
+    // groups, followed by the FX forward groups, followed by the trades priced individually.
+    // work is a work area.
+    void price_range(Market& mkt, size_t g, size_t begin, size_t end, portfolio_values_t& prices, std::vector<double>& work) const;
+
+    void price_payments(Market& mkt, const PaymentGroup& grp, size_t begin, size_t end, portfolio_values_t& prices, std::vector<double>& work) const;
+    void price_fx_forwards(Market& mkt, const FXForwardGroup& grp, size_t begin, size_t end, portfolio_values_t& prices, std::vector<double>& work) const;
+
+    // number of trades in group g
+    size_t group_size(size_t g) const;
+
+    size_t m_size;
+    std::vector<PaymentGroup> m_payments;
+    std::vector<FXForwardGroup> m_fx_forwards;
+    std::vector<ppricer_t> m_other_pricers;
+    std::vector<size_t> m_other_position;
+};
+
+} // namespace minirisk
@@ -0,0 +1,267 @@
+#include "PortfolioBinary.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <algorithm>
+
+#ifdef _WIN32
+#  include <iterator>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace minirisk {
+
+namespace {
+
+const char magic[4] = { 'M', 'R', 'P', 'F' };
+const uint32_t version = 2;  // version of the files written, older versions can still be read
+
+struct header_t
+{
+    char     magic[4];
+    uint32_t version;
+    uint64_t n_trades;
+    uint32_t n_sections;
+    uint32_t reserved;
+};
+
+struct section_t
+{
+    uint32_t guid;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t offset;
+};
+
+struct payment_record_t
+{
+    uint32_t position;
+    uint32_t delivery;
+    double   quantity;
+    char     ccy[8];
+};
+
+struct fx_forward_record_t
+{
+    uint32_t position;
+    uint32_t fixing;
+    uint32_t settlement;
+    uint32_t reserved;
+    double   quantity;
+    double   strike;
+    char     base_ccy[8];
+    char     quote_ccy[8];
+};
+
+// smallest record of all trade types
+const size_t min_record_size = std::min(sizeof(payment_record_t), sizeof(fx_forward_record_t));
+
+// copy a currency code into a fixed width, zero padded field
+template <size_t N>
+void set_ccy(char (&field)[N], const string& ccy)
+{
+    MYASSERT(ccy.length() < N, "Invalid currency " << ccy);
+    std::memcpy(field, ccy.data(), ccy.length());
+}
+
+template <size_t N>
+string get_ccy(const char (&field)[N])
+{
+    return string(field, strnlen(field, N));
+}
+
+// Read only view of a whole file, memory mapped where available
+struct MappedFile
+{
+    MappedFile(const string& filename)
+    {
+#ifdef _WIN32
+        std::ifstream is(filename, std::ios::binary);
+        MYASSERT(!is.fail(), "Could not open file " << filename);
+        m_buffer.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        MYASSERT(fd >= 0, "Could not open file " << filename);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            THROW("Could not read file size of " << filename);
+        }
+        m_size = static_cast<size_t>(st.st_size);
+        if (m_size > 0) {
+            void *p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            MYASSERT(p != MAP_FAILED, "Could not map file " << filename);
+            m_data = static_cast<const char *>(p);
+        }
+        else {
+            ::close(fd);
+        }
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (m_data)
+            ::munmap(const_cast<char *>(m_data), m_size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    std::vector<char> m_buffer;
+#endif
+};
+
+// read a trivially copyable object at a given offset, checking the file bounds
+template <typename T>
+T read_at(const MappedFile& f, uint64_t offset)
+{
+    MYASSERT(offset <= f.size() && sizeof(T) <= f.size() - offset, "Corrupted binary portfolio: unexpected end of file");
+    T res;
+    std::memcpy(&res, f.data() + offset, sizeof(T));
+    return res;
+}
+
+template <typename T>
+void write(std::ofstream& of, const T& v)
+{
+    of.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+} // anonymous namespace
+
+void save_portfolio_binary(const string& filename, const portfolio_t& portfolio)
+{
+    // group trades by type
+    std::vector<payment_record_t> payments;
+    std::vector<fx_forward_record_t> fx_forwards;
+    for (size_t i = 0; i < portfolio.size(); ++i) {
+        if (const TradePayment *p = dynamic_cast<const TradePayment *>(portfolio[i].get())) {
+            payment_record_t r;
+            std::memset(&r, 0, sizeof(r));
+            r.position = static_cast<uint32_t>(i);
+            r.delivery = p->delivery_date().get_m_serial();
+            r.quantity = p->quantity();
+            set_ccy(r.ccy, p->ccy());
+            payments.push_back(r);
+        }
+        else if (const TradeFXForward *f = dynamic_cast<const TradeFXForward *>(portfolio[i].get())) {
+            fx_forward_record_t r;
+            std::memset(&r, 0, sizeof(r));
+            r.position = static_cast<uint32_t>(i);
+            r.fixing = f->fixing_date().get_m_serial();
+            r.settlement = f->settlement_date().get_m_serial();
+            r.quantity = f->quantity();
+            r.strike = f->strike();
+            set_ccy(r.base_ccy, f->base_ccy());
+            set_ccy(r.quote_ccy, f->quote_ccy());
+            fx_forwards.push_back(r);
+        }
+        else
+            THROW("Binary format not supported for trade type " << portfolio[i]->idname());
+    }
+
+    std::vector<section_t> sections;
+    uint64_t offset = sizeof(header_t) + 2 * sizeof(section_t);
+    sections.push_back(section_t{ TradePayment::m_id, sizeof(payment_record_t), payments.size(), offset });
+    offset += payments.size() * sizeof(payment_record_t);
+    sections.push_back(section_t{ TradeFXForward::m_id, sizeof(fx_forward_record_t), fx_forwards.size(), offset });
+
+    header_t h;
+    std::memcpy(h.magic, magic, sizeof(magic));
+    h.version = version;
+    h.n_trades = portfolio.size();
+    h.n_sections = static_cast<uint32_t>(sections.size());
+    h.reserved = 0;
+
+    std::ofstream of(filename, std::ios::binary);
+    MYASSERT(!of.fail(), "Could not open file " << filename);
+    write(of, h);
+    for (const auto& s : sections)
+        write(of, s);
+    of.write(reinterpret_cast<const char *>(payments.data()), payments.size() * sizeof(payment_record_t));
+    of.write(reinterpret_cast<const char *>(fx_forwards.data()), fx_forwards.size() * sizeof(fx_forward_record_t));
+    MYASSERT(!of.fail(), "Could not write file " << filename);
+}
+
+portfolio_t load_portfolio_binary(const string& filename)
+{
+    MappedFile f(filename);
+
+    header_t h = read_at<header_t>(f, 0);
+    MYASSERT(std::memcmp(h.magic, magic, sizeof(magic)) == 0, "Not a binary portfolio file: " << filename);
+    MYASSERT(h.version >= 1 && h.version <= version, "Unsupported binary portfolio version " << h.version << " in " << filename);
+
+    // validate the header before allocating anything: every section needs an entry in the section
+    // table and every trade needs a record of at least the size of the smallest record type
+    const uint64_t payload = f.size() - sizeof(header_t);
+    MYASSERT(h.n_sections <= payload / sizeof(section_t), "Corrupted binary portfolio: " << h.n_sections << " sections exceed file size");
+    MYASSERT(h.n_trades <= (payload - h.n_sections * sizeof(section_t)) / min_record_size
+        , "Corrupted binary portfolio: " << h.n_trades << " trades exceed file size");
+
+    portfolio_t portfolio(h.n_trades);
+    auto check_position = [&portfolio](uint32_t position) {
+        MYASSERT(position < portfolio.size() && !portfolio[position], "Corrupted binary portfolio: invalid trade position " << position);
+    };
+    for (uint32_t k = 0; k < h.n_sections; ++k) {
+        section_t s = read_at<section_t>(f, sizeof(header_t) + k * sizeof(section_t));
+        MYASSERT(s.record_size != 0 && s.offset <= f.size() && s.count <= (f.size() - s.offset) / s.record_size
+            , "Corrupted binary portfolio: section " << k << " exceeds file size");
+        if (s.guid == TradePayment::m_id) {
+            MYASSERT(s.record_size == sizeof(payment_record_t), "Unexpected record size " << s.record_size << " for trade type " << s.guid);
+            for (uint64_t i = 0; i < s.count; ++i) {
+                payment_record_t r = read_at<payment_record_t>(f, s.offset + i * sizeof(payment_record_t));
+                check_position(r.position);
+                TradePayment *p = new TradePayment;
+                portfolio[r.position].reset(p);
+                p->init(get_ccy(r.ccy), r.quantity, Date(r.delivery));
+            }
+        }
+        else if (s.guid == TradeFXForward::m_id && h.version >= 2) {
+            MYASSERT(s.record_size == sizeof(fx_forward_record_t), "Unexpected record size " << s.record_size << " for trade type " << s.guid);
+            for (uint64_t i = 0; i < s.count; ++i) {
+                fx_forward_record_t r = read_at<fx_forward_record_t>(f, s.offset + i * sizeof(fx_forward_record_t));
+                check_position(r.position);
+                TradeFXForward *p = new TradeFXForward;
+                portfolio[r.position].reset(p);
+                p->init(get_ccy(r.base_ccy), get_ccy(r.quote_ccy), r.quantity, r.strike, Date(r.fixing), Date(r.settlement));
+            }
+        }
+        else
+            THROW("Unknown trade type " << s.guid << " in binary portfolio version " << h.version);
+    }
+
+    for (size_t i = 0; i < portfolio.size(); ++i)
+        MYASSERT(portfolio[i], "Corrupted binary portfolio: missing trade " << i);
+
+    return portfolio;
+}
+
+bool is_portfolio_binary(const string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    char buf[sizeof(magic)];
+    return is.read(buf, sizeof(buf)) && std::memcmp(buf, magic, sizeof(magic)) == 0;
+}
+
+} // namespace minirisk
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ITrade.h"
+
+namespace minirisk {
+
+// Binary portfolio file format (version 2), all numbers in native byte order:
+//
+//   header:   char magic[4] = "MRPF", uint32 version, uint64 number of trades,
+//             uint32 number of sections, uint32 reserved
+//   sections: one per trade type, each described by
+//             uint32 trade guid, uint32 record size, uint64 number of trades, uint64 file offset
+//   records:  fixed width records, one per trade, stored contiguously for each section.
+//             Each record starts with the uint32 position of the trade in the portfolio.
+//
+// Records layout:
+//   Payment:     uint32 position, uint32 delivery date serial, double quantity, char ccy[8]
+//   FX.Forward:  uint32 position, uint32 fixing date serial, uint32 settlement date serial,
+//                uint32 reserved, double quantity, double strike, char base ccy[8], char quote ccy[8]
+//
+// Version history:
+//   1: Payment section only
+//   2: adds the FX.Forward section (version 1 files can still be loaded)
+
+// save portfolio to file in binary format
+void save_portfolio_binary(const string& filename, const portfolio_t& portfolio);
+
+// load portfolio from a file in binary format, mapping the file in memory
+portfolio_t load_portfolio_binary(const string& filename);
+
+// check if a file starts with the binary portfolio signature
+bool is_portfolio_binary(const string& filename);
+
+} // namespace minirisk
@@ -1,38 +1,98 @@
 #include "Global.h"
 #include "PortfolioUtils.h"
 #include "TradePayment.h"
+#include "TradeFXForward.h"
+#include "PortfolioBinary.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
 
 #include <numeric>
 #include <set>
 
 namespace minirisk {
 
+const symbol_t all_risk_factors = intern("*");
+
 void print_portfolio(const portfolio_t& portfolio)
 {
     std::for_each(portfolio.begin(), portfolio.end(), [](auto& pt){ pt->print(std::cout); });
 }
 
-std::vector<ppricer_t> get_pricers(const portfolio_t& portfolio)
+std::vector<ppricer_t> get_pricers(const portfolio_t& portfolio, const string& base_ccy)
 {
     std::vector<ppricer_t> pricers(portfolio.size());
     std::transform( portfolio.begin(), portfolio.end(), pricers.begin()
-                  , [](auto &pt) -> ppricer_t { return pt->pricer(); } );
+                  , [&base_ccy](auto &pt) -> ppricer_t { return pt->pricer(base_ccy); } );
     return pricers;
 }
 
+trade_value_t price_trade(const IPricer& pricer, Market& mkt)
+{
+    try {
+        return checked_trade_value(pricer.price(mkt));
+    }
+    catch (const std::exception& e) {
+        return trade_error(e.what());
+    }
+    catch (...) {
+        return trade_error("Unknown error");
+    }
+}
+
 portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, Market& mkt)
 {
     portfolio_values_t prices(pricers.size());
     std::transform(pricers.begin(), pricers.end(), prices.begin()
-        , [&mkt](auto &pp) -> double { return pp->price(mkt); });
+        , [&mkt](auto &pp) -> trade_value_t { return price_trade(*pp, mkt); });
     return prices;
 }
 
+portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, Market& mkt, ThreadPool& pool)
+{
+    // serial pricing keeps the market in its plain lazy mode
+    if (pool.size() == 1)
+        return compute_prices(pricers, mkt);
 
+    ConcurrentMarketScope scope(mkt);
+    if (!scope.concurrent())
+        return compute_prices(pricers, mkt);
 
-double portfolio_total(const portfolio_values_t& values)
+    portfolio_values_t prices(pricers.size());
+    pool.parallel_for(pricers.size(), price_chunk_size, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; ++i)
+            prices[i] = price_trade(*pricers[i], mkt);
+    });
+    return prices;
+}
+
+std::vector<Market::risk_factor_deps_t> compute_dependencies(const std::vector<ppricer_t>& pricers, Market& mkt)
+{
+    std::vector<Market::risk_factor_deps_t> deps(pricers.size());
+    for (size_t i = 0; i < pricers.size(); ++i) {
+        mkt.record_dependencies(&deps[i]);
+        try {
+            pricers[i]->price(mkt);
+        }
+        catch (...) {
+            // the dependencies of a trade which cannot be priced are unknown
+            deps[i].clear();
+            deps[i].insert(all_risk_factors);
+        }
+    }
+    mkt.record_dependencies(nullptr);
+    return deps;
+}
+
+std::pair<double, size_t> portfolio_total(const portfolio_values_t& values)
 {
-    return std::accumulate(values.begin(), values.end(), 0.0);
+    std::pair<double, size_t> total(0.0, 0);
+    for (const auto& v : values) {
+        if (is_error(v))
+            ++total.second;
+        else
+            total.first += v.first;
+    }
+    return total;
 }
 
 // std::vector<std::pair<string, portfolio_values_t>> compute_pv01(const std::vector<ppricer_t>& pricers, const Market& mkt)
@@ -80,107 +140,281 @@ double portfolio_total(const portfolio_values_t& values)
 //     return pv01;
 // }
 
-std::vector<std::pair<string, portfolio_values_t>> compute_pv01_bucketed(const std::vector<ppricer_t>& pricers, const Market& mkt)
+// For each scenario, returns the indices of the trades depending on at least one of the bumped
+// risk factors, in increasing order.
+static std::vector<std::vector<size_t>> affected_trades(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , const std::vector<Market::vec_risk_factor_t>& scenarios)
+{
+    PROFILE_SCOPE("dependencies");
+    Market tmpmkt(mkt);
+    std::vector<Market::risk_factor_deps_t> deps(compute_dependencies(pricers, tmpmkt));
+
+    // invert the dependencies: for each risk factor, the trades depending on it
+    std::map<symbol_t, std::vector<size_t>> trades_by_factor;
+    std::vector<size_t> always; // trades to be repriced in all scenarios
+    for (size_t i = 0; i < deps.size(); ++i) {
+        if (deps[i].count(all_risk_factors))
+            always.push_back(i);
+        else
+            for (symbol_t f : deps[i])
+                trades_by_factor[f].push_back(i);
+    }
+
+    std::vector<std::vector<size_t>> affected(scenarios.size());
+    for (size_t k = 0; k < scenarios.size(); ++k) {
+        std::set<size_t> idx(always.begin(), always.end());
+        for (const auto& d : scenarios[k]) {
+            auto iter = trades_by_factor.find(d.first);
+            if (iter != trades_by_factor.end())
+                idx.insert(iter->second.begin(), iter->second.end());
+        }
+        affected[k].assign(idx.begin(), idx.end());
+    }
+    return affected;
+}
+
+// compute prices of the selected trades only
+static portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, const std::vector<size_t>& selected, Market& mkt)
+{
+    portfolio_values_t prices(selected.size());
+    std::transform(selected.begin(), selected.end(), prices.begin()
+        , [&pricers, &mkt](size_t i) -> trade_value_t { return price_trade(*pricers[i], mkt); });
+    return prices;
+}
+
+// Bump and reprice a list of scenarios. The risk factors of scenario k are shifted down and
+// up by bump_sizes[k], and the sensitivity is estimated via central finite differences.
+// Only the trades depending on the bumped risk factors are repriced, the PV01 of all other
+// trades is zero. Returns the number of trade repricings, i.e. two per affected trade and scenario.
+// Scenarios are distributed over the threads of pool, each of them owning its own copy of the
+// Market object. Every scenario is always computed in the same way (bump down, bump up, restore)
+// no matter which thread processes it, hence the results are identical to the ones of the
+// serial path.
+static size_t bump_and_reprice(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , const std::vector<Market::vec_risk_factor_t>& scenarios, const std::vector<double>& bump_sizes
+    , std::vector<std::pair<string, portfolio_values_t>>& pv01, ThreadPool& pool)
+{
+    MYASSERT(pv01.size() == scenarios.size(), "Expected one result per scenario, got " << pv01.size() << " and " << scenarios.size());
+    MYASSERT(bump_sizes.size() == scenarios.size(), "Expected one bump size per scenario, got " << bump_sizes.size() << " and " << scenarios.size());
+
+    const std::vector<std::vector<size_t>> affected(affected_trades(pricers, mkt, scenarios));
+
+    PROFILE_SCOPE("bump and reprice");
+
+    // Make a local copy of the Market object per thread, because we will modify it applying bumps
+    // Note that the base snapshot is shared, only the bumps and the curves built from
+    // them are local to the copy
+    std::vector<Market> mkts(pool.size(), mkt);
+
+    pool.parallel_for(scenarios.size(), 1, [&](size_t begin, size_t end, unsigned thread) {
+        Market& tmpmkt = mkts[thread];
+        for (size_t k = begin; k < end; ++k) {
+            const Market::vec_risk_factor_t& base = scenarios[k];
+            const std::vector<size_t>& selected = affected[k];
+            const double bump_size = bump_sizes[k];
+            Market::vec_risk_factor_t bumped(base);
+            portfolio_values_t pv_up, pv_dn;
+
+            // bump down and price
+            for (size_t i = 0; i < base.size(); ++i)
+                bumped[i].second = base[i].second - bump_size;
+            tmpmkt.set_risk_factors(bumped);
+            pv_dn = compute_prices(pricers, selected, tmpmkt);
+
+            // bump up and price
+            for (size_t i = 0; i < base.size(); ++i)
+                bumped[i].second = base[i].second + bump_size;
+            tmpmkt.set_risk_factors(bumped);
+            pv_up = compute_prices(pricers, selected, tmpmkt);
+
+            // restore original market state for next iteration
+            // (more efficient than creating a new copy of the market at every iteration)
+            tmpmkt.set_risk_factors(base);
+
+            // compute estimator of the derivative via central finite differences,
+            // a trade which cannot be priced in either scenario reports the error
+            double dr = 2.0 * bump_size;
+            pv01[k].second.assign(pricers.size(), trade_value(0.0));
+            for (size_t i = 0; i < selected.size(); ++i) {
+                if (is_error(pv_dn[i]))
+                    pv01[k].second[selected[i]] = pv_dn[i];
+                else if (is_error(pv_up[i]))
+                    pv01[k].second[selected[i]] = pv_up[i];
+                else
+                    pv01[k].second[selected[i]] = trade_value((pv_up[i].first - pv_dn[i].first) / dr);
+            }
+        }
+    });
+
+    size_t n_reprices = 0;
+    for (const auto& selected : affected)
+        n_reprices += 2 * selected.size();
+    return n_reprices;
+}
+
+std::vector<std::pair<string, portfolio_values_t>> compute_pv01_bucketed(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool& pool, size_t *n_reprices)
 {
     std::vector<std::pair<string, portfolio_values_t>> pv01;  // PV01 per trade
 
     const double bump_size = 0.01 / 100;
 
     // filter risk factors related to IR
-    auto base = mkt.get_risk_factors(ir_rate_prefix + "\\d+[DWMY].[A-Z]{3}");
-
-    // Make a local copy of the Market object, because we will modify it applying bumps
-    // Note that the actual market objects are shared, as they are referred to via pointers
-    Market tmpmkt(mkt);
+    auto base = mkt.get_risk_factors(RiskFactorKey::ir_rate);
 
-    // compute prices for perturbated markets and aggregate results
+    // one scenario per risk factor
+    std::vector<Market::vec_risk_factor_t> scenarios;
+    scenarios.reserve(base.size());
     pv01.reserve(base.size());
     for (const auto& d : base) {
-        std::vector<double> pv_up, pv_dn;
-        std::vector<std::pair<string, double>> bumped(1, d);
-        pv01.push_back(std::make_pair("bucketed " + d.first, std::vector<double>(pricers.size())));
+        scenarios.push_back(Market::vec_risk_factor_t(1, d));
+        pv01.push_back(std::make_pair("bucketed " + symbol_name(d.first), portfolio_values_t()));
+    }
+
+    // compute prices for perturbated markets and aggregate results
+    size_t n = bump_and_reprice(pricers, mkt, scenarios, std::vector<double>(scenarios.size(), bump_size), pv01, pool);
+    if (n_reprices)
+        *n_reprices = n;
 
-        // bump down and price
-        bumped[0].second = d.second - bump_size;
-        tmpmkt.set_risk_factors(bumped);
-        pv_dn = compute_prices(pricers, tmpmkt);
+    return pv01;
+}
 
-        // bump up and price
-        bumped[0].second = d.second + bump_size; // bump up
-        tmpmkt.set_risk_factors(bumped);
-        pv_up = compute_prices(pricers, tmpmkt);
+std::vector<std::pair<string, portfolio_values_t>> compute_pv01_parallel(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool& pool, size_t *n_reprices)
+{
+    std::vector<std::pair<string, portfolio_values_t>> pv01;  // PV01 per trade
 
+    const double bump_size = 0.01 / 100;
 
-        // restore original market state for next iteration
-        // (more efficient than creating a new copy of the market at every iteration)
-        bumped[0].second = d.second;
-        tmpmkt.set_risk_factors(bumped);
+    // currencies of the risk factors related to IR
+    std::set<string> ccy_set(mkt.get_currencies(RiskFactorKey::ir_rate));
 
-        // compute estimator of the derivative via central finite differences
-        double dr = 2.0 * bump_size;
-        std::transform(pv_up.begin(), pv_up.end(), pv_dn.begin(), pv01.back().second.begin()
-            , [dr](double hi, double lo) -> double { return (hi - lo) / dr; });
+    // one scenario per currency, shifting all tenors of the yield curve at once
+    std::vector<Market::vec_risk_factor_t> scenarios;
+    scenarios.reserve(ccy_set.size());
+    pv01.reserve(ccy_set.size());
+    for (const string& ccy : ccy_set)
+    {
+        scenarios.push_back(mkt.get_ir_risk_factors(ccy));
+        pv01.push_back(std::make_pair("parallel " + ir_rate_prefix + ccy, portfolio_values_t()));
     }
 
+    // compute prices for perturbated markets and aggregate results
+    size_t n = bump_and_reprice(pricers, mkt, scenarios, std::vector<double>(scenarios.size(), bump_size), pv01, pool);
+    if (n_reprices)
+        *n_reprices = n;
+
     return pv01;
 }
 
-std::vector<std::pair<string, portfolio_values_t>> compute_pv01_parallel(const std::vector<ppricer_t>& pricers, const Market& mkt)
+std::vector<std::pair<string, portfolio_values_t>> compute_fx_delta(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool& pool, size_t *n_reprices)
 {
-    std::vector<std::pair<string, portfolio_values_t>> pv01;  // PV01 per trade
+    std::vector<std::pair<string, portfolio_values_t>> fx_delta;  // FX delta per trade
 
-    const double bump_size = 0.01 / 100;
+    const double rel_bump_size = 0.1 / 100;
 
-    // filter risk factors related to IR
-    auto base = mkt.get_risk_factors(ir_rate_prefix + "\\d+[DWMY].[A-Z]{3}");
+    // filter risk factors related to FX spots
+    auto base = mkt.get_risk_factors(RiskFactorKey::fx_spot);
 
-    // Make a local copy of the Market object, because we will modify it applying bumps
-    // Note that the actual market objects are shared, as they are referred to via pointers
-    Market tmpmkt(mkt);
+    // one scenario per currency, the bump is relative to the level of the spot
+    std::vector<Market::vec_risk_factor_t> scenarios;
+    std::vector<double> bump_sizes;
+    scenarios.reserve(base.size());
+    bump_sizes.reserve(base.size());
+    fx_delta.reserve(base.size());
+    for (const auto& d : base) {
+        scenarios.push_back(Market::vec_risk_factor_t(1, d));
+        bump_sizes.push_back(rel_bump_size * d.second);
+        fx_delta.push_back(std::make_pair("FX delta " + symbol_name(d.first), portfolio_values_t()));
+    }
 
-    std::set<string> ccy_set;
-    for (const auto& b : base)
-    {
-        if (b.first.length() >= 3)
-        {
-            ccy_set.insert(b.first.substr(b.first.length() - 3));
+    // only the trades touching the bumped currency are repriced
+    size_t n = bump_and_reprice(pricers, mkt, scenarios, bump_sizes, fx_delta, pool);
+    if (n_reprices)
+        *n_reprices = n;
+
+    return fx_delta;
+}
+
+// Price each trade once, computing the gradient of its price with respect to all risk factors.
+// For each risk factor in pos, its gradient is added to each of the positions of the result
+// vectors it is mapped to. A trade which cannot be priced reports the error in all results.
+static void accumulate_gradients(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , const std::map<symbol_t, std::vector<std::pair<string, portfolio_values_t> *>>& pos
+    , const std::vector<std::vector<std::pair<string, portfolio_values_t>> *>& results)
+{
+    PROFILE_SCOPE("price gradients");
+    Market tmpmkt(mkt);
+    for (size_t i = 0; i < pricers.size(); ++i) {
+        risk_gradient_t grad;
+        trade_value_t error;
+        try {
+            pricers[i]->price_with_gradient(tmpmkt, grad);
+        }
+        catch (const std::exception& e) {
+            error = trade_error(e.what());
+        }
+        catch (...) {
+            error = trade_error("Unknown error");
+        }
+        if (is_error(error)) {
+            for (auto r : results)
+                for (auto& v : *r)
+                    v.second[i] = error;
+            continue;
+        }
+        for (const auto& g : grad) {
+            auto p = pos.find(g.first);
+            if (p == pos.end())
+                continue; // not a requested risk factor
+            for (auto v : p->second)
+                v->second[i].first += g.second;
         }
     }
+}
 
-    for (const string& ccy : ccy_set)
-    {
-        auto ccy_base = mkt.get_risk_factors(ir_rate_prefix + "\\d+[DWMY]." + ccy);
-        std::vector<double> pv_up, pv_dn;
-        std::vector<std::pair<string, double>> bumped;
-        pv01.push_back(std::make_pair("parallel " + ir_rate_prefix + ccy, std::vector<double>(pricers.size())));
-
-        // bump down and price
-        for (const auto& cb : ccy_base)
-        {
-            bumped.emplace_back(cb.first, cb.second - bump_size);
-        }
-        tmpmkt.set_risk_factors(bumped);
-        pv_dn = compute_prices(pricers, tmpmkt);
+void compute_pv01_analytic(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , std::vector<std::pair<string, portfolio_values_t>>& pv01_bucketed
+    , std::vector<std::pair<string, portfolio_values_t>>& pv01_parallel)
+{
+    // same risk factors and ordering as for the finite differences
+    auto base = mkt.get_risk_factors(RiskFactorKey::ir_rate);
+    std::set<string> ccy_set(mkt.get_currencies(RiskFactorKey::ir_rate));
+
+    pv01_parallel.clear();
+    std::map<string, size_t> parallel_pos;  // currency -> position in pv01_parallel
+    for (const string& ccy : ccy_set) {
+        parallel_pos[ccy] = pv01_parallel.size();
+        pv01_parallel.push_back(std::make_pair("parallel " + ir_rate_prefix + ccy, portfolio_values_t(pricers.size(), trade_value(0.0))));
+    }
 
-        // bump up and price
-        for (size_t i = 0; i < ccy_base.size(); ++i) {
-            bumped[i].second = ccy_base[i].second + bump_size;
-        }
-        tmpmkt.set_risk_factors(bumped);
-        pv_up = compute_prices(pricers, tmpmkt);
+    pv01_bucketed.clear();
+    pv01_bucketed.reserve(base.size());
+    std::map<symbol_t, std::vector<std::pair<string, portfolio_values_t> *>> pos;  // risk factor -> bucketed and parallel results
+    for (const auto& d : base) {
+        pv01_bucketed.push_back(std::make_pair("bucketed " + symbol_name(d.first), portfolio_values_t(pricers.size(), trade_value(0.0))));
+        pos[d.first] = { &pv01_bucketed.back(), &pv01_parallel[parallel_pos[parse_risk_factor(symbol_name(d.first)).ccy]] };
+    }
 
-        // restore original market state
-        for (size_t i = 0; i < ccy_base.size(); ++i) {
-            bumped[i].second = ccy_base[i].second; // reset to original value
-        }
-        tmpmkt.set_risk_factors(bumped);
+    // a single pricing pass per trade, the parallel PV01 is the sum of the bucketed PV01s
+    accumulate_gradients(pricers, mkt, pos, { &pv01_bucketed, &pv01_parallel });
+}
+
+std::vector<std::pair<string, portfolio_values_t>> compute_fx_delta_analytic(const std::vector<ppricer_t>& pricers, const Market& mkt)
+{
+    // same risk factors and ordering as for the finite differences
+    auto base = mkt.get_risk_factors(RiskFactorKey::fx_spot);
 
-        double dr = 2.0 * bump_size;
-        std::transform(pv_up.begin(), pv_up.end(), pv_dn.begin(), pv01.back().second.begin()
-            , [dr](double hi, double lo) -> double { return (hi - lo) / dr; });  
+    std::vector<std::pair<string, portfolio_values_t>> fx_delta;
+    fx_delta.reserve(base.size());
+    std::map<symbol_t, std::vector<std::pair<string, portfolio_values_t> *>> pos;  // risk factor -> result
+    for (const auto& d : base) {
+        fx_delta.push_back(std::make_pair("FX delta " + symbol_name(d.first), portfolio_values_t(pricers.size(), trade_value(0.0))));
+        pos[d.first] = { &fx_delta.back() };
     }
 
-    return pv01;
+    // the pricers differentiate the conversion into the base currency, hence the delta
+    // comes from the local currency PV without any reprice
+    accumulate_gradients(pricers, mkt, pos, { &fx_delta });
+    return fx_delta;
 }
 
 
@@ -195,6 +429,8 @@ ptrade_t load_trade(my_ifstream& is)
 
     if (id == TradePayment::m_id)
         p.reset(new TradePayment);
+    else if (id == TradeFXForward::m_id)
+        p.reset(new TradeFXForward);
     else
         THROW("Unknown trade type:" << id);
 
@@ -216,6 +452,9 @@ void save_portfolio(const string& filename, const std::vector<ptrade_t>& portfol
 
 std::vector<ptrade_t> load_portfolio(const string& filename)
 {
+    if (is_portfolio_binary(filename))
+        return load_portfolio_binary(filename);
+
     std::vector<ptrade_t> portfolio;
 
     // test reloading the portfolio
@@ -228,15 +467,22 @@ std::vector<ptrade_t> load_portfolio(const string& filename)
 
 void print_price_vector(const string& name, const portfolio_values_t& values)
 {
+    std::pair<double, size_t> total = portfolio_total(values);
     std::cout
         << "========================\n"
         << name << ":\n"
         << "========================\n"
-        << "Total: " << portfolio_total(values)
+        << "Total:  " << total.first << "\n"
+        << "Errors: " << total.second << "\n"
         << "\n========================\n";
 
-    for (size_t i = 0, n = values.size(); i < n; ++i)
-        std::cout << std::setw(5) << i << ": " << values[i] << "\n";
+    for (size_t i = 0, n = values.size(); i < n; ++i) {
+        std::cout << std::setw(5) << i << ": ";
+        if (is_error(values[i]))
+            std::cout << values[i].second << "\n";
+        else
+            std::cout << values[i].first << "\n";
+    }
 
     std::cout << "========================\n\n";
 }
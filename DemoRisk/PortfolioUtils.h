@@ -1,6 +1,8 @@
 #pragma once
 
 #include <vector>
+#include <limits>
+#include <cmath>
 
 #include "ITrade.h"
 #include "IPricer.h"
@@ -8,30 +10,90 @@
 namespace minirisk {
 
 struct Market;
+struct ThreadPool;
 
-typedef std::vector<double> portfolio_values_t;
+// Value of a trade, or the error message if the trade cannot be priced (the value is then NaN)
+typedef std::pair<double, string> trade_value_t;
+typedef std::vector<trade_value_t> portfolio_values_t;
 
-// get pricer for each trade
-std::vector<ppricer_t> get_pricers(const portfolio_t& portfolio);
+inline trade_value_t trade_value(double v)
+{
+    return trade_value_t(v, string());
+}
 
-// compute prices
+inline trade_value_t trade_error(const string& msg)
+{
+    return trade_value_t(std::numeric_limits<double>::quiet_NaN(), msg.empty() ? string("Unknown error") : msg);
+}
+
+inline bool is_error(const trade_value_t& v)
+{
+    return !v.second.empty();
+}
+
+// value of a trade, where a price which is not a number is reported as an error
+inline trade_value_t checked_trade_value(double v)
+{
+    return std::isnan(v) ? trade_error("Price is not a number") : trade_value(v);
+}
+
+// Number of trades priced by a thread in one go in the parallel loops: large enough to amortize
+// the scheduling overhead, small enough to balance the load and to keep the data in cache
+const size_t price_chunk_size = 256;
+
+// get pricer for each trade, computing prices in currency base_ccy
+std::vector<ppricer_t> get_pricers(const portfolio_t& portfolio, const string& base_ccy = "USD");
+
+// price a trade, capturing the error message if it cannot be priced
+trade_value_t price_trade(const IPricer& pricer, Market& mkt);
+
+// compute prices, capturing the error of each trade which cannot be priced
 portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, Market& mkt);
 
-// compute the cumulative book value
-double portfolio_total(const portfolio_values_t& values);
+// Compute prices in parallel over the threads of pool, if the market can be made concurrent.
+// Results are in the same order as the pricers.
+portfolio_values_t compute_prices(const std::vector<ppricer_t>& pricers, Market& mkt, ThreadPool& pool);
+
+// special dependency assigned to the trades which cannot be priced: they depend on all risk factors
+extern const symbol_t all_risk_factors;
+
+// compute the risk factors on which the price of each trade depends
+std::vector<Market::risk_factor_deps_t> compute_dependencies(const std::vector<ppricer_t>& pricers, Market& mkt);
+
+// compute the cumulative book value of the trades which could be priced, and the number of
+// trades which could not
+std::pair<double, size_t> portfolio_total(const portfolio_values_t& values);
 
 // Compute PV01 (i.e. sensitivity with respect to interest rate dV/dr)
 // Use central differences, absolute bump of 0.01%, rescale result for rate movement of 0.01%
 //std::vector<std::pair<string, portfolio_values_t>> compute_pv01(const std::vector<ppricer_t>& pricers, const Market& mkt);
 
-std::vector<std::pair<string, portfolio_values_t>> compute_pv01_bucketed(const std::vector<ppricer_t>& pricers, const Market& mkt);
+// Bump-and-reprice scenarios are distributed over the threads of pool, each owning its own
+// copy of the market. The results do not depend on the number of threads.
+// Only the trades depending on the bumped risk factors are repriced. If n_reprices is not null,
+// it is set to the number of trade repricings (two per repriced trade and scenario).
+std::vector<std::pair<string, portfolio_values_t>> compute_pv01_bucketed(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool& pool, size_t *n_reprices = nullptr);
+
+std::vector<std::pair<string, portfolio_values_t>> compute_pv01_parallel(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool& pool, size_t *n_reprices = nullptr);
+
+// Compute bucketed and parallel PV01 analytically, from the price gradient of each trade.
+// This requires a single pricing pass, instead of two full reprices per bumped scenario.
+void compute_pv01_analytic(const std::vector<ppricer_t>& pricers, const Market& mkt
+    , std::vector<std::pair<string, portfolio_values_t>>& pv01_bucketed
+    , std::vector<std::pair<string, portfolio_values_t>>& pv01_parallel);
+
+// Compute FX delta (i.e. sensitivity dV/dS with respect to each FX.SPOT.<ccy> risk factor)
+// Use central differences, with a bump of 0.1% relative to the spot level.
+// Only the trades touching the bumped currency are repriced, n_reprices as above.
+std::vector<std::pair<string, portfolio_values_t>> compute_fx_delta(const std::vector<ppricer_t>& pricers, const Market& mkt, ThreadPool& pool, size_t *n_reprices = nullptr);
 
-std::vector<std::pair<string, portfolio_values_t>> compute_pv01_parallel(const std::vector<ppricer_t>& pricers, const Market& mkt);
+// Compute FX delta analytically, from the price gradient of each trade, in a single pass.
+std::vector<std::pair<string, portfolio_values_t>> compute_fx_delta_analytic(const std::vector<ppricer_t>& pricers, const Market& mkt);
 
 // save portfolio to file
 void save_portfolio(const string& filename, const std::vector<ptrade_t>& portfolio);
 
-// load portfolio from file
+// load portfolio from file, either in text or binary format
 std::vector<ptrade_t>  load_portfolio(const string& filename);
 
 // print portfolio to cout
@@ -0,0 +1,66 @@
+#include "PricerFXForward.h"
+#include "TradeFXForward.h"
+
+namespace minirisk {
+
+PricerFXForward::PricerFXForward(const TradeFXForward& trd, const string& base_ccy)
+    : m_amt(trd.quantity())
+    , m_strike(trd.strike())
+    , m_fixing(trd.fixing_date())
+    , m_settlement(trd.settlement_date())
+    , m_ids(intern_fx_forward(trd.base_ccy(), trd.quote_ccy()))
+    , m_fx_spot(trd.quote_ccy() == base_ccy ? null_symbol : intern(fx_spot_name(trd.quote_ccy(), base_ccy)))
+{
+}
+
+bool PricerFXForward::historical_fixing(const Market& mkt, double& fwd) const
+{
+    // fixings before today must be available, today's fixing may not be published yet
+    if (m_fixing < mkt.today()) {
+        fwd = mkt.get_fixing(m_ids.fx_spot, m_fixing);
+        return true;
+    }
+    if (m_fixing == mkt.today()) {
+        std::pair<double, bool> fixing = mkt.lookup_fixing(m_ids.fx_spot, m_fixing);
+        fwd = fixing.first;
+        return fixing.second;
+    }
+    return false;
+}
+
+double PricerFXForward::price(Market& mkt) const
+{
+    ptr_disc_curve_t disc = mkt.get_discount_curve(m_ids.disc2);
+    double df = disc->df(m_settlement); // this throws an exception if m_settlement<today
+
+    // if the exchange rate is already fixed, use the historical fixing
+    double fwd;
+    if (!historical_fixing(mkt, fwd))
+        fwd = mkt.get_fx_forward_curve(m_ids.fwd_curve)->fwd(m_fixing);
+
+    // This PV is expressed in the quote currency. It must be converted in the base currency.
+    if (m_fx_spot != null_symbol)
+        df *= mkt.get_fx_spot_curve(m_fx_spot)->spot();
+
+    return m_amt * ((fwd - m_strike) * df);
+}
+
+double PricerFXForward::price_with_gradient(Market& mkt, risk_gradient_t& grad) const
+{
+    // PV = amt * (fwd - strike) * df * fx
+    ptr_disc_curve_t disc = mkt.get_discount_curve(m_ids.disc2);
+    double df = disc->df(m_settlement);
+    ptr_fx_spot_curve_t fx_spot = (m_fx_spot != null_symbol) ? mkt.get_fx_spot_curve(m_fx_spot) : nullptr;
+    double fx = fx_spot ? fx_spot->spot() : 1.0;
+    double fwd;
+    if (!historical_fixing(mkt, fwd)) // fixings are not risk factors
+        fwd = mkt.get_fx_forward_curve(m_ids.fwd_curve)->fwd(m_fixing, m_amt * df * fx, grad);
+
+    disc->df(m_settlement, m_amt * (fwd - m_strike) * fx, grad);
+    if (fx_spot)
+        fx_spot->spot(m_amt * ((fwd - m_strike) * df), grad);
+    return m_amt * ((fwd - m_strike) * (df * fx));
+}
+
+} // namespace minirisk
+
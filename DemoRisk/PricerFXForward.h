@@ -0,0 +1,30 @@
+#pragma once
+
+#include "IPricer.h"
+#include "TradeFXForward.h"
+#include "CurveFXForward.h"
+
+namespace minirisk {
+
+struct PricerFXForward : IPricer
+{
+    PricerFXForward(const TradeFXForward& trd, const string& base_ccy);
+
+    virtual double price(Market& m) const;
+
+    virtual double price_with_gradient(Market& m, risk_gradient_t& grad) const;
+
+private:
+    // true if the exchange rate is already fixed, in which case fwd is set to the historical fixing
+    bool historical_fixing(const Market& mkt, double& fwd) const;
+
+    double   m_amt;
+    double   m_strike;
+    Date     m_fixing;
+    Date     m_settlement;
+    fx_forward_ids_t m_ids;  // forward curve, and the curves and the FX pair fixing it depends on
+    symbol_t m_fx_spot;      // FX spot of the quote currency in the base currency, null_symbol if no conversion is needed
+};
+
+} // namespace minirisk
+
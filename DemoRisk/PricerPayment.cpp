@@ -4,11 +4,11 @@
 
 namespace minirisk {
 
-PricerPayment::PricerPayment(const TradePayment& trd)
+PricerPayment::PricerPayment(const TradePayment& trd, const string& base_ccy)
     : m_amt(trd.quantity())
     , m_dt(trd.delivery_date())
-    , m_ir_curve(ir_curve_discount_name(trd.ccy()))
-    , m_fx_ccy(trd.ccy() == "USD" ? "" : fx_spot_name(trd.ccy(),"USD"))
+    , m_ir_curve(intern(ir_curve_discount_name(trd.ccy())))
+    , m_fx_spot(trd.ccy() == base_ccy ? null_symbol : intern(fx_spot_name(trd.ccy(), base_ccy)))
 {
 }
 
@@ -17,13 +17,25 @@ double PricerPayment::price(Market& mkt) const
     ptr_disc_curve_t disc = mkt.get_discount_curve(m_ir_curve);
     double df = disc->df(m_dt); // this throws an exception if m_dt<today
 
-    // This PV is expressed in m_ccy. It must be converted in USD.
-    if (!m_fx_ccy.empty())
-        df *= mkt.get_fx_spot(m_fx_ccy);
+    // This PV is expressed in m_ccy. It must be converted in the base currency.
+    if (m_fx_spot != null_symbol)
+        df *= mkt.get_fx_spot_curve(m_fx_spot)->spot();
 
     return m_amt * df;
 }
 
+double PricerPayment::price_with_gradient(Market& mkt, risk_gradient_t& grad) const
+{
+    // PV = amt * df * fx
+    ptr_disc_curve_t disc = mkt.get_discount_curve(m_ir_curve);
+    ptr_fx_spot_curve_t fx_spot = (m_fx_spot != null_symbol) ? mkt.get_fx_spot_curve(m_fx_spot) : nullptr;
+    double fx = fx_spot ? fx_spot->spot() : 1.0;
+    double df = disc->df(m_dt, m_amt * fx, grad);
+    if (fx_spot)
+        fx_spot->spot(m_amt * df, grad);
+    return m_amt * (df * fx);
+}
+
 } // namespace minirisk
 
 
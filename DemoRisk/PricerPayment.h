@@ -7,15 +7,17 @@ namespace minirisk {
 
 struct PricerPayment : IPricer
 {
-    PricerPayment(const TradePayment& trd);
+    PricerPayment(const TradePayment& trd, const string& base_ccy);
 
     virtual double price(Market& m) const;
 
+    virtual double price_with_gradient(Market& m, risk_gradient_t& grad) const;
+
 private:
-    double m_amt;
-    Date   m_dt;
-    string m_ir_curve;
-    string m_fx_ccy;
+    double   m_amt;
+    Date     m_dt;
+    symbol_t m_ir_curve;
+    symbol_t m_fx_spot;   // FX spot of the trade currency in the base currency, null_symbol if no conversion is needed
 };
 
 } // namespace minirisk
@@ -0,0 +1,97 @@
+#include "Profiler.h"
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+
+namespace minirisk {
+
+namespace {
+
+const char *counter_names[profile_n_counters] = {
+    "curve builds",
+    "curve cache hits",
+    "curve bumps",
+    "mds fetches",
+    "regex matches",
+    "df calls"
+};
+
+// registry of the counters of the live threads, and totals of the threads already terminated
+struct profile_registry_t
+{
+    std::mutex m_mutex;
+    std::vector<const ProfileCounters *> m_live;
+    uint64_t m_retired[profile_n_counters] = {};
+    std::vector<std::pair<string, double>> m_phases;  // phase name -> milliseconds, in order of first use
+};
+
+profile_registry_t& registry()
+{
+    static profile_registry_t r;
+    return r;
+}
+
+} // namespace
+
+ProfileCounters::ProfileCounters()
+{
+    for (auto& c : m_counts)
+        c.store(0, std::memory_order_relaxed);
+    profile_registry_t& r = registry();
+    std::lock_guard<std::mutex> lock(r.m_mutex);
+    r.m_live.push_back(this);
+}
+
+ProfileCounters::~ProfileCounters()
+{
+    profile_registry_t& r = registry();
+    std::lock_guard<std::mutex> lock(r.m_mutex);
+    for (int c = 0; c < profile_n_counters; ++c)
+        r.m_retired[c] += get(static_cast<profile_counter_t>(c));
+    r.m_live.erase(std::find(r.m_live.begin(), r.m_live.end(), this));
+}
+
+ProfileScope::~ProfileScope()
+{
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    profile_registry_t& r = registry();
+    std::lock_guard<std::mutex> lock(r.m_mutex);
+    auto iter = std::find_if(r.m_phases.begin(), r.m_phases.end(), [this](const auto& p) { return p.first == m_name; });
+    if (iter == r.m_phases.end())
+        r.m_phases.emplace_back(m_name, ms);
+    else
+        iter->second += ms;
+}
+
+uint64_t profile_count(profile_counter_t c)
+{
+    profile_registry_t& r = registry();
+    std::lock_guard<std::mutex> lock(r.m_mutex);
+    uint64_t n = r.m_retired[c];
+    for (const ProfileCounters *p : r.m_live)
+        n += p->get(c);
+    return n;
+}
+
+void print_profile(std::ostream& os)
+{
+    std::vector<std::pair<string, double>> phases;
+    {
+        profile_registry_t& r = registry();
+        std::lock_guard<std::mutex> lock(r.m_mutex);
+        phases = r.m_phases;
+    }
+
+    os  << "========================\n"
+        << "Profile:\n"
+        << "========================\n";
+    for (const auto& p : phases)
+        os << std::setw(28) << std::left << (p.first + " [ms]") << std::right << p.second << "\n";
+    for (int c = 0; c < profile_n_counters; ++c)
+        os << std::setw(28) << std::left << counter_names[c] << std::right << profile_count(static_cast<profile_counter_t>(c)) << "\n";
+    os << "========================\n\n";
+}
+
+} // namespace minirisk
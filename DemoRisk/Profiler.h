@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "Global.h"
+
+// Lightweight instrumentation, compiled in only when PROFILE is defined (make PROFILE=1):
+//   PROFILE_SCOPE("name")    accumulates the wall clock time spent in the enclosing scope
+//   PROFILE_COUNT(counter)   increments one of the counters in profile_counter_t
+//   PROFILE_ADD(counter, n)  adds n to one of the counters in profile_counter_t
+// Otherwise the macros expand to nothing and have no run time cost.
+
+namespace minirisk {
+
+enum profile_counter_t
+{
+    profile_curve_builds,     // curves built by Market::get_curve
+    profile_curve_cache_hits, // curves reused from the cache of destroyed curves
+    profile_curve_bumps,      // curves derived from a base curve by bumping a single pillar
+    profile_mds_fetches,      // risk factors fetched from the market data server
+    profile_regex_matches,    // names matched against a regular expression
+    profile_df_calls,         // discount factors computed
+    profile_n_counters
+};
+
+// Per-thread counters: each thread increments its own counters without any synchronization
+// other than relaxed atomic loads and stores, and the totals are summed up on demand.
+struct ProfileCounters
+{
+    ProfileCounters();
+    ~ProfileCounters();
+
+    void add(profile_counter_t c, uint64_t n)
+    {
+        m_counts[c].store(m_counts[c].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    uint64_t get(profile_counter_t c) const
+    {
+        return m_counts[c].load(std::memory_order_relaxed);
+    }
+
+    // counters of the calling thread
+    static ProfileCounters& local()
+    {
+        static thread_local ProfileCounters counters;
+        return counters;
+    }
+
+private:
+    std::atomic<uint64_t> m_counts[profile_n_counters];
+};
+
+// Adds the time elapsed between construction and destruction to a named phase
+struct ProfileScope
+{
+    explicit ProfileScope(const char *name)
+        : m_name(name)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ProfileScope();
+
+private:
+    const char *m_name;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// total of a counter over all threads, past and present
+uint64_t profile_count(profile_counter_t c);
+
+// print the time spent in each phase, in order of first use, and the value of all counters
+void print_profile(std::ostream& os);
+
+} // namespace minirisk
+
+#ifdef PROFILE
+#  define PROFILE_CONCAT_(a, b) a##b
+#  define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#  define PROFILE_SCOPE(name) ::minirisk::ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+#  define PROFILE_ADD(counter, n) ::minirisk::ProfileCounters::local().add(::minirisk::counter, (n))
+#  define PROFILE_COUNT(counter) PROFILE_ADD(counter, 1)
+#  define PROFILE_REPORT(os) ::minirisk::print_profile(os)
+#else
+#  define PROFILE_SCOPE(name)
+#  define PROFILE_ADD(counter, n)
+#  define PROFILE_COUNT(counter)
+#  define PROFILE_REPORT(os)
+#endif
@@ -0,0 +1,125 @@
+#include "ResultSink.h"
+
+#include <cstring>
+
+namespace minirisk {
+
+ResultSinkCSV::ResultSinkCSV(const string& filename)
+    : m_of(filename)
+{
+    MYASSERT(m_of.is_open(), "Could not open file " << filename);
+    m_of.write("result,trade,value,error\n");
+}
+
+// append s to the file as a CSV field, quoting it if needed
+static void write_csv_field(my_ofstream& of, std::string_view s)
+{
+    if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+        of.write(s);
+        return;
+    }
+    of.put('"');
+    for (char c : s) {
+        if (c == '"')
+            of.put('"');
+        of.put(c);
+    }
+    of.put('"');
+}
+
+void ResultSinkCSV::write(const string& name, const portfolio_values_t& values)
+{
+    char buf[32];
+    for (size_t i = 0; i < values.size(); ++i) {
+        write_csv_field(m_of, name);
+        m_of.put(',');
+        auto res = std::to_chars(buf, buf + sizeof(buf), i);
+        m_of.write(std::string_view(buf, res.ptr - buf));
+        m_of.put(',');
+        if (is_error(values[i])) {
+            m_of.put(',');
+            write_csv_field(m_of, values[i].second);
+        }
+        else {
+            res = std::to_chars(buf, buf + sizeof(buf), values[i].first);
+            m_of.write(std::string_view(buf, res.ptr - buf));
+            m_of.put(',');
+        }
+        m_of.endl();
+    }
+}
+
+void ResultSinkCSV::close()
+{
+    m_of.close();
+    MYASSERT(!m_of.fail(), "Could not write results");
+}
+
+namespace {
+
+const char magic[4] = { 'M', 'R', 'R', 'S' };
+const uint32_t version = 1;
+
+} // namespace
+
+ResultSinkBinary::ResultSinkBinary(const string& filename)
+    : m_of(filename, std::ios::out | std::ios::binary)
+{
+    MYASSERT(m_of.is_open(), "Could not open file " << filename);
+}
+
+void ResultSinkBinary::write_string(const string& s)
+{
+    write_pod(static_cast<uint32_t>(s.length()));
+    m_of.write(s);
+}
+
+void ResultSinkBinary::write_header(uint64_t n_trades)
+{
+    m_n_trades = n_trades;
+    m_of.write(std::string_view(magic, sizeof(magic)));
+    write_pod(version);
+    write_pod(m_n_trades);
+    m_header_written = true;
+}
+
+void ResultSinkBinary::write(const string& name, const portfolio_values_t& values)
+{
+    // the number of trades is known from the first result
+    if (!m_header_written)
+        write_header(values.size());
+    MYASSERT(values.size() == m_n_trades, "Expected " << m_n_trades << " values for " << name << ", got " << values.size());
+
+    write_string(name);
+    uint32_t n_errors = 0;
+    for (const auto& v : values) {
+        write_pod(v.first);
+        n_errors += is_error(v);
+    }
+    write_pod(n_errors);
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (is_error(values[i])) {
+            write_pod(static_cast<uint32_t>(i));
+            write_string(values[i].second);
+        }
+    }
+}
+
+void ResultSinkBinary::close()
+{
+    if (!m_header_written)
+        write_header(0);
+    m_of.close();
+    MYASSERT(!m_of.fail(), "Could not write results");
+}
+
+presult_sink_t make_result_sink(const string& filename, const string& format)
+{
+    if (format == "csv")
+        return presult_sink_t(new ResultSinkCSV(filename));
+    if (format == "bin")
+        return presult_sink_t(new ResultSinkBinary(filename));
+    THROW("Unknown results format: " << format);
+}
+
+} // namespace minirisk
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+
+#include "IObject.h"
+#include "Streamer.h"
+#include "PortfolioUtils.h"
+
+namespace minirisk {
+
+// Destination of the results of the risk engine. Results are written one at a time, each of
+// them being a named vector with the value of every trade, in the order of the portfolio.
+struct IResultSink : IObject
+{
+    virtual void write(const string& name, const portfolio_values_t& values) = 0;
+
+    // flush all pending data to the destination, no more results can be written afterwards
+    virtual void close() = 0;
+};
+
+typedef std::unique_ptr<IResultSink> presult_sink_t;
+
+// CSV file, one line per trade per result:
+//   result,trade,value,error
+// where value is empty if the trade cannot be priced, and the error message is quoted.
+// Values are formatted with std::to_chars (shortest representation which round trips).
+struct ResultSinkCSV : IResultSink
+{
+    ResultSinkCSV(const string& filename);
+
+    virtual void write(const string& name, const portfolio_values_t& values);
+    virtual void close();
+
+private:
+    my_ofstream m_of;
+};
+
+// Binary results file format (version 1), all numbers in native byte order:
+//
+//   header:   char magic[4] = "MRRS", uint32 version, uint64 number of trades
+//   columns:  one per result, until the end of the file, each made of
+//             uint32 name length, name,
+//             double value[number of trades]      (NaN if the trade cannot be priced)
+//             uint32 number of errors, then for each error
+//             uint32 position of the trade, uint32 message length, message
+struct ResultSinkBinary : IResultSink
+{
+    ResultSinkBinary(const string& filename);
+
+    virtual void write(const string& name, const portfolio_values_t& values);
+    virtual void close();
+
+private:
+    template <typename T>
+    void write_pod(const T& v)
+    {
+        m_of.write(std::string_view(reinterpret_cast<const char *>(&v), sizeof(T)));
+    }
+
+    void write_string(const string& s);
+    void write_header(uint64_t n_trades);
+
+    my_ofstream m_of;
+    bool m_header_written = false;
+    uint64_t m_n_trades = 0;
+};
+
+// open a sink writing to filename in a given format (csv or bin)
+presult_sink_t make_result_sink(const string& filename, const string& format);
+
+} // namespace minirisk
@@ -0,0 +1,149 @@
+#include "RiskCube.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+
+#include <map>
+#include <iomanip>
+
+namespace minirisk {
+
+std::vector<group_by_t> parse_group_by(const string& keys)
+{
+    std::vector<group_by_t> group_by;
+    size_t begin = 0;
+    while (begin <= keys.length()) {
+        size_t end = keys.find(',', begin);
+        if (end == string::npos)
+            end = keys.length();
+        const string key = keys.substr(begin, end - begin);
+        if (key == "ccy")
+            group_by.push_back(group_by_currency);
+        else if (key == "type")
+            group_by.push_back(group_by_trade_type);
+        else if (key == "maturity")
+            group_by.push_back(group_by_maturity);
+        else if (!key.empty())
+            THROW("Unknown group-by key: " << key);
+        begin = end + 1;
+    }
+    return group_by;
+}
+
+// maturity bucket of a trade, from its time to maturity in years
+static string maturity_bucket(double t)
+{
+    if (t < 0.0)
+        return "expired";
+    if (t < 1.0)
+        return "0-1Y";
+    if (t < 2.0)
+        return "1Y-2Y";
+    if (t < 5.0)
+        return "2Y-5Y";
+    if (t < 10.0)
+        return "5Y-10Y";
+    return "10Y+";
+}
+
+// label of the bucket of trade trd
+static string bucket_label(const ITrade& trd, const Date& today, const std::vector<group_by_t>& group_by)
+{
+    // currency of the PV and maturity of the trade, when the trade type is known
+    string ccy = "-", maturity = "-";
+    if (const TradePayment *p = dynamic_cast<const TradePayment *>(&trd)) {
+        ccy = p->ccy();
+        maturity = maturity_bucket(time_frac(today, p->delivery_date()));
+    }
+    else if (const TradeFXForward *f = dynamic_cast<const TradeFXForward *>(&trd)) {
+        ccy = f->quote_ccy();
+        maturity = maturity_bucket(time_frac(today, f->settlement_date()));
+    }
+
+    string label;
+    for (group_by_t g : group_by) {
+        if (!label.empty())
+            label += " ";
+        switch (g)
+        {
+        case group_by_currency:
+            label += ccy;
+            break;
+        case group_by_trade_type:
+            label += trd.idname();
+            break;
+        case group_by_maturity:
+            label += maturity;
+            break;
+        }
+    }
+    return label.empty() ? string("All") : label;
+}
+
+RiskCube::RiskCube(const portfolio_t& portfolio, const Date& today, const std::vector<group_by_t>& group_by)
+    : m_bucket(portfolio.size())
+{
+    // buckets are numbered in the order of their labels
+    std::vector<string> trade_labels(portfolio.size());
+    std::map<string, size_t> buckets;
+    for (size_t i = 0; i < portfolio.size(); ++i) {
+        trade_labels[i] = bucket_label(*portfolio[i], today, group_by);
+        buckets.emplace(trade_labels[i], 0);
+    }
+    for (auto& b : buckets) {
+        b.second = m_labels.size();
+        m_labels.push_back(b.first);
+    }
+    for (size_t i = 0; i < portfolio.size(); ++i)
+        m_bucket[i] = buckets[trade_labels[i]];
+}
+
+void RiskCube::add(const string& name, const portfolio_values_t& values)
+{
+    MYASSERT(values.size() == m_bucket.size(), "Expected " << m_bucket.size() << " values for " << name << ", got " << values.size());
+
+    const size_t n = buckets();
+    m_names.push_back(name);
+    m_values.resize(m_values.size() + n, 0.0);
+    m_errors.resize(m_errors.size() + n, 0);
+    double *row_values = &m_values[m_values.size() - n];
+    size_t *row_errors = &m_errors[m_errors.size() - n];
+
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (is_error(values[i]))
+            ++row_errors[m_bucket[i]];
+        else
+            row_values[m_bucket[i]] += values[i].first;
+    }
+}
+
+void RiskCube::print(std::ostream& os) const
+{
+    for (size_t r = 0; r < rows(); ++r) {
+        double total = 0.0;
+        size_t total_errors = 0;
+        for (size_t b = 0; b < buckets(); ++b) {
+            total += value(r, b);
+            total_errors += errors(r, b);
+        }
+        os
+            << "========================\n"
+            << name(r) << ":\n"
+            << "========================\n"
+            << "Total:  " << total << "\n"
+            << "Errors: " << total_errors << "\n"
+            << "\n========================\n";
+
+        for (size_t b = 0; b < buckets(); ++b) {
+            if (value(r, b) == 0.0 && errors(r, b) == 0)
+                continue;
+            os << std::setw(28) << std::left << label(b) << std::right << value(r, b);
+            if (errors(r, b))
+                os << " (" << errors(r, b) << " errors)";
+            os << "\n";
+        }
+
+        os << "========================\n\n";
+    }
+}
+
+} // namespace minirisk
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <vector>
+#include <ostream>
+
+#include "ITrade.h"
+#include "PortfolioUtils.h"
+
+namespace minirisk {
+
+// Trade attributes the results can be aggregated by
+enum group_by_t { group_by_currency, group_by_trade_type, group_by_maturity };
+
+// parse a comma separated list of group-by keys (e.g. "ccy,type,maturity")
+std::vector<group_by_t> parse_group_by(const string& keys);
+
+// Dense aggregation of per-trade results: one row per result (e.g. per risk factor), one
+// column per bucket, where a bucket is a distinct combination of the group-by attributes.
+// The bucket of each trade is computed once, then each row is reduced in a single pass over
+// the contiguous per-trade values, accumulating into a small contiguous row of the cube.
+struct RiskCube
+{
+    // trades are assigned to buckets according to the attributes in group_by, in that order.
+    // Maturity buckets are computed relatively to today.
+    RiskCube(const portfolio_t& portfolio, const Date& today, const std::vector<group_by_t>& group_by);
+
+    // aggregate a new row, values must be in the same order as the trades in the portfolio
+    void add(const string& name, const portfolio_values_t& values);
+
+    // aggregate one row per result
+    void add(const std::vector<std::pair<string, portfolio_values_t>>& results)
+    {
+        for (const auto& r : results)
+            add(r.first, r.second);
+    }
+
+    size_t rows() const { return m_names.size(); }
+    size_t buckets() const { return m_labels.size(); }
+
+    const string& name(size_t row) const { return m_names[row]; }
+    const string& label(size_t bucket) const { return m_labels[bucket]; }
+
+    // cumulative value of the trades of a bucket which could be priced
+    double value(size_t row, size_t bucket) const { return m_values[row * buckets() + bucket]; }
+
+    // number of trades of a bucket which could not be priced
+    size_t errors(size_t row, size_t bucket) const { return m_errors[row * buckets() + bucket]; }
+
+    // print the total of each row and its non empty buckets
+    void print(std::ostream& os) const;
+
+private:
+    std::vector<size_t> m_bucket;   // bucket of each trade
+    std::vector<string> m_labels;   // label of each bucket, sorted
+    std::vector<string> m_names;    // name of each row
+    std::vector<double> m_values;   // rows x buckets, row major
+    std::vector<size_t> m_errors;   // rows x buckets, row major
+};
+
+} // namespace minirisk
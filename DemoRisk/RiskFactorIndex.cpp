@@ -0,0 +1,111 @@
+#include "RiskFactorIndex.h"
+
+#include <algorithm>
+
+namespace minirisk {
+
+// check if s is a currency code, i.e. three upper case letters
+static bool is_ccy(const string& s)
+{
+    return s.length() == 3
+        && std::all_of(s.begin(), s.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+// convert a tenor like 10W into a number of days, returns false if the format is not valid
+static bool tenor_to_days(const string& tenor, unsigned& days)
+{
+    if (tenor.length() < 2)
+        return false;
+    unsigned unit = 0;
+    for (size_t i = 0; i + 1 < tenor.length(); ++i) {
+        if (tenor[i] < '0' || tenor[i] > '9')
+            return false;
+        unit = unit * 10 + (tenor[i] - '0');
+    }
+    unsigned period = 0;
+    switch (tenor.back())
+    {
+    case 'D':
+        period = 1;
+        break;
+    case 'W':
+        period = 7;
+        break;
+    case 'M':
+        period = 30;
+        break;
+    case 'Y':
+        period = 365;
+        break;
+    default:
+        return false;
+    }
+    days = unit * period;
+    return true;
+}
+
+RiskFactorKey parse_risk_factor(const string& name, symbol_t id)
+{
+    RiskFactorKey key{ RiskFactorKey::other, "", 0, name, id };
+
+    if (name.compare(0, fx_spot_prefix.length(), fx_spot_prefix) == 0) {
+        string ccy = name.substr(fx_spot_prefix.length());
+        if (is_ccy(ccy)) {
+            key.asset_class = RiskFactorKey::fx_spot;
+            key.ccy = ccy;
+        }
+    }
+    else if (name.compare(0, ir_rate_prefix.length(), ir_rate_prefix) == 0) {
+        // expected format is IR.<tenor>.<ccy>
+        size_t dot = name.find('.', ir_rate_prefix.length());
+        if (dot != string::npos) {
+            string ccy = name.substr(dot + 1);
+            unsigned days;
+            if (is_ccy(ccy) && tenor_to_days(name.substr(ir_rate_prefix.length(), dot - ir_rate_prefix.length()), days)) {
+                key.asset_class = RiskFactorKey::ir_rate;
+                key.ccy = ccy;
+                key.tenor = days;
+            }
+        }
+    }
+
+    return key;
+}
+
+void RiskFactorIndex::insert(symbol_t id)
+{
+    m_keys.insert(parse_risk_factor(symbol_name(id), id));
+}
+
+std::vector<RiskFactorIndex::tenor_symbol_t> RiskFactorIndex::ir_rates(const string& ccy) const
+{
+    std::vector<tenor_symbol_t> res;
+    RiskFactorKey lo{ RiskFactorKey::ir_rate, ccy, 0, "", null_symbol };
+    for (auto i = m_keys.lower_bound(lo); i != m_keys.end() && i->asset_class == RiskFactorKey::ir_rate && i->ccy == ccy; ++i)
+        res.emplace_back(i->tenor, i->id);
+    return res;
+}
+
+std::vector<symbol_t> RiskFactorIndex::symbols(RiskFactorKey::asset_class_t asset_class) const
+{
+    std::map<string, symbol_t> res;
+    RiskFactorKey lo{ asset_class, "", 0, "", null_symbol };
+    for (auto i = m_keys.lower_bound(lo); i != m_keys.end() && i->asset_class == asset_class; ++i)
+        res.emplace(i->name, i->id);
+    std::vector<symbol_t> ids;
+    ids.reserve(res.size());
+    for (const auto& r : res)
+        ids.push_back(r.second);
+    return ids;
+}
+
+std::set<string> RiskFactorIndex::currencies(RiskFactorKey::asset_class_t asset_class) const
+{
+    std::set<string> res;
+    RiskFactorKey lo{ asset_class, "", 0, "", null_symbol };
+    for (auto i = m_keys.lower_bound(lo); i != m_keys.end() && i->asset_class == asset_class; ++i)
+        res.insert(i->ccy);
+    return res;
+}
+
+} // namespace minirisk
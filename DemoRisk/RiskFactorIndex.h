@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "Global.h"
+#include "SymbolTable.h"
+
+namespace minirisk {
+
+// Structured representation of a risk factor name, parsed only once
+//   IR.<n><D|W|M|Y>.<ccy>   ->  (ir_rate, ccy, tenor in days)
+//   FX.SPOT.<ccy>           ->  (fx_spot, ccy, 0)
+//   anything else           ->  (other, "", 0)
+struct RiskFactorKey
+{
+    enum asset_class_t { ir_rate, fx_spot, other };
+
+    asset_class_t asset_class;
+    string ccy;
+    unsigned tenor;   // number of days
+    string name;      // original name, used to break ties (e.g. IR.1M.EUR and IR.30D.EUR)
+    symbol_t id;      // interned name
+
+    bool operator<(const RiskFactorKey& k) const
+    {
+        if (asset_class != k.asset_class)
+            return asset_class < k.asset_class;
+        if (ccy != k.ccy)
+            return ccy < k.ccy;
+        if (tenor != k.tenor)
+            return tenor < k.tenor;
+        return name < k.name;
+    }
+};
+
+// parse a risk factor name into its components
+RiskFactorKey parse_risk_factor(const string& name, symbol_t id = null_symbol);
+
+// Index over a set of risk factor names, supporting range queries by asset class and currency
+// without any regular expression matching.
+struct RiskFactorIndex
+{
+    typedef std::pair<unsigned, symbol_t> tenor_symbol_t;
+
+    // add a risk factor to the index (risk factors already indexed are ignored)
+    void insert(symbol_t id);
+
+    // IR rates of currency ccy, sorted by tenor
+    std::vector<tenor_symbol_t> ir_rates(const string& ccy) const;
+
+    // all risk factors of a given asset class, sorted by name
+    std::vector<symbol_t> symbols(RiskFactorKey::asset_class_t asset_class) const;
+
+    // currencies having at least one risk factor of a given asset class, sorted
+    std::set<string> currencies(RiskFactorKey::asset_class_t asset_class) const;
+
+private:
+    std::set<RiskFactorKey> m_keys;  // structured keys, sorted by asset class, currency and tenor
+};
+
+} // namespace minirisk
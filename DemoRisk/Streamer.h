@@ -6,6 +6,11 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
 
 #include "Global.h"
 #include "Date.h"
@@ -20,45 +25,139 @@ const char separator = ';';
 // Overload classes
 //
 
+// Writes a file (text, or binary if opened in binary mode) through a large buffer. Data is only
+// handed over to the file when the buffer is full or on explicit flush/close, not at the end of
+// every line.
 struct my_ofstream
 {
-    my_ofstream(const string& fn)
-        : m_of(fn)
+    my_ofstream(const string& fn, std::ios::openmode mode = std::ios::out)
+        : m_of(fn, mode)
     {
+        m_buffer.reserve(buffer_size);
     }
-    void endl() { m_of << std::endl; }
-    void close() { m_of.close(); }
+    ~my_ofstream() { close(); }
+    bool is_open() const { return m_of.is_open(); }
+    bool fail() const { return m_of.fail(); }
+    void endl() { put('\n'); }
+    void flush()
+    {
+        if (m_of.is_open()) {
+            m_of.write(m_buffer.data(), m_buffer.size());
+            m_of.flush();
+        }
+        m_buffer.clear();
+    }
+    void close()
+    {
+        if (m_of.is_open()) {
+            flush();
+            m_of.close();
+        }
+    }
+
+    void put(char c)
+    {
+        m_buffer.push_back(c);
+        if (m_buffer.size() >= buffer_size)
+            write_buffer();
+    }
+    void write(std::string_view s)
+    {
+        m_buffer.append(s);
+        if (m_buffer.size() >= buffer_size)
+            write_buffer();
+    }
+
+private:
+    // hand over the buffer content to the file, without flushing it
+    void write_buffer()
+    {
+        m_of.write(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+    static const size_t buffer_size = 1 << 20;
     std::ofstream m_of;
+    string m_buffer;
 };
 
+// Reads a text file through a large buffer, one line at a time. Lines and tokens are returned as
+// views into the buffer, so that no memory is allocated while parsing.
 struct my_ifstream
 {
     my_ifstream(const string& fn)
-        : m_if(fn)
+        : m_if(fn, std::ios::binary)
+        , m_buffer(1 << 20)
     {
         MYASSERT(!m_if.fail(), "Could not open file " << fn);
     }
 
     bool read_line()
     {
-        std::getline(m_if, m_line);  // read a line and store it in m_line
-        m_line_stream.str(m_line);   // associate a string stream with m_line
+        for (;;) {
+            const char *begin = m_buffer.data() + m_begin;
+            const char *eol = static_cast<const char *>(std::memchr(begin, '\n', m_end - m_begin));
+            if (eol) {
+                m_line = std::string_view(begin, eol - begin);
+                m_begin += m_line.length() + 1;
+                break;
+            }
+            if (m_eof) { // last line, not terminated by a new line
+                m_line = std::string_view(begin, m_end - m_begin);
+                m_begin = m_end;
+                break;
+            }
+            fill();
+        }
+        if (!m_line.empty() && m_line.back() == '\r')
+            m_line.remove_suffix(1);
+        m_pos = 0;
         return m_line.length() > 0;
     }
 
-    inline string read_token()
+    inline std::string_view read_token()
     {
-        string tmp;
-        std::getline(m_line_stream, tmp, separator);
+        size_t sep = std::min(m_line.find(separator, m_pos), m_line.length());
+        std::string_view tmp = m_line.substr(m_pos, sep - m_pos);
+        m_pos = std::min(sep + 1, m_line.length());
         return tmp;
     }
 
 private:
-    string m_line;
-    std::istringstream m_line_stream;
+    // move the unread data at the beginning of the buffer and append more data from the file
+    void fill()
+    {
+        size_t n = m_end - m_begin;
+        std::memmove(m_buffer.data(), m_buffer.data() + m_begin, n);
+        m_begin = 0;
+        m_end = n;
+        if (m_end == m_buffer.size()) // line longer than the buffer
+            m_buffer.resize(2 * m_buffer.size());
+        m_if.read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+        m_end += static_cast<size_t>(m_if.gcount());
+        m_eof = !m_if;
+    }
+
+private:
     std::ifstream m_if;
+    std::vector<char> m_buffer;
+    size_t m_begin = 0;       // first character not consumed yet
+    size_t m_end = 0;         // end of the data read from the file
+    bool m_eof = false;
+    std::string_view m_line;  // current line
+    size_t m_pos = 0;         // position of the next token in the current line
 };
 
+// parse an integer number, without any memory allocation
+template <typename T>
+inline T parse_integer(std::string_view s, int base = 10)
+{
+    T v{};
+    auto res = std::from_chars(s.data(), s.data() + s.length(), v, base);
+    MYASSERT(res.ec == std::errc() && res.ptr == s.data() + s.length(), "Invalid number: " << s);
+    return v;
+}
+
 //
 // Generic file streamer
 //
@@ -66,15 +165,48 @@ private:
 template <typename T>
 inline my_ifstream& operator>>(my_ifstream& is, T& v)
 {
-    string tmp = is.read_token();
+    string tmp(is.read_token());
     std::istringstream(tmp) >> v;
     return is;
 }
 
+template <typename T> requires std::is_integral_v<T>
+inline my_ifstream& operator>>(my_ifstream& is, T& v)
+{
+    v = parse_integer<T>(is.read_token());
+    return is;
+}
+
+inline my_ifstream& operator>>(my_ifstream& is, string& v)
+{
+    v = is.read_token();
+    return is;
+}
+
 template <typename T>
 inline my_ofstream& operator<<(my_ofstream& os, const T& v)
 {
-    os.m_of << v << separator;
+    std::ostringstream tmp;
+    tmp << v;
+    os.write(tmp.str());
+    os.put(separator);
+    return os;
+}
+
+template <typename T> requires std::is_integral_v<T>
+inline my_ofstream& operator<<(my_ofstream& os, const T& v)
+{
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), v);
+    os.write(std::string_view(buf, res.ptr - buf));
+    os.put(separator);
+    return os;
+}
+
+inline my_ofstream& operator<<(my_ofstream& os, const string& v)
+{
+    os.write(v);
+    os.put(separator);
     return os;
 }
 
@@ -94,24 +226,23 @@ inline my_ofstream& operator<<(my_ofstream& os, double v)
     } tmp;
     tmp.d = v;
 
-    // os.m_of << std::hex << tmp.u << separator;
-    os.m_of << std::hex << std::setfill('0') << std::setw(16) << tmp.u << separator;
+    // encode the 64 bits pattern as 16 hexadecimal digits, padded with zeros
+    const char digits[] = "0123456789abcdef";
+    char buf[16];
+    for (int i = 15; i >= 0; --i, tmp.u >>= 4)
+        buf[i] = digits[tmp.u & 0xf];
+    os.write(std::string_view(buf, sizeof(buf)));
+    os.put(separator);
 
     return os;
 }
 
 // when reading a double from a file in text format, read the hexadecimal format integer number
-// and re-interpret it as a double
+// and re-interpret it as a double. Numbers in decimal notation are also accepted, provided that
+// they contain a decimal point or start with a sign (e.g. 10.0, -1.5e+05, 1.0000000000000000e+01),
+// since a token of digits only is a valid 64 bits pattern.
 inline my_ifstream& operator>>(my_ifstream& is, double& v)
 {
-    // // read the hexadecimal string and then convert the string from hexadecimal to uint64_t
-    // string hex_string = is.read_token(); 
-    // uint64_t int_format;
-    // std::istringstream(hex_string) >> std::hex >> int_format;
-
-    std::string hex_string;
-    is >> hex_string; // read hexadecimal string from stream
-
     // re-interpret uint64_t as a double
     union
     {
@@ -119,9 +250,18 @@ inline my_ifstream& operator>>(my_ifstream& is, double& v)
         uint64_t u;
     } tmp;
 
+    std::string_view s = is.read_token();
+    if (s.find('.') != std::string_view::npos || (!s.empty() && (s[0] == '-' || s[0] == '+'))) {
+        // decimal notation (from_chars does not accept a leading plus sign)
+        std::string_view d = (s[0] == '+') ? s.substr(1) : s;
+        auto res = std::from_chars(d.data(), d.data() + d.length(), v);
+        MYASSERT(res.ec == std::errc() && res.ptr == d.data() + d.length(), "Invalid number: " << s);
+        return is;
+    }
+    MYASSERT(s.length() == 16, "Invalid number: " << s << " (64 bits hexadecimal pattern expected)");
+
     // convert hexadecimal string into uint64_t
-    std::istringstream hex_stream(hex_string);
-    hex_stream >> std::hex >> tmp.u;
+    tmp.u = parse_integer<uint64_t>(s, 16);
 
     // assign double value to v
     v = tmp.d;
@@ -181,19 +321,18 @@ inline my_ofstream& operator<<(my_ofstream& os, const Date& d)
 
 inline my_ifstream& operator>>(my_ifstream& is, Date& v)
 {
-    string tmp;
-    is >> tmp;
+    std::string_view tmp = is.read_token();
 
     if (tmp.size() == 8) // read YYYYMMDD format
     {
-        unsigned y = std::atoi(tmp.substr(0, 4).c_str());
-        unsigned m = std::atoi(tmp.substr(4, 2).c_str());
-        unsigned d = std::atoi(tmp.substr(6, 2).c_str());
+        unsigned y = parse_integer<unsigned>(tmp.substr(0, 4));
+        unsigned m = parse_integer<unsigned>(tmp.substr(4, 2));
+        unsigned d = parse_integer<unsigned>(tmp.substr(6, 2));
         v.init(y, m, d);
     }
     else // read Serial format
     {
-        unsigned serial = std::atoi(tmp.c_str());
+        unsigned serial = parse_integer<unsigned>(tmp);
         v.init(serial);
     }
     return is;
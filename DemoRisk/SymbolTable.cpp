@@ -0,0 +1,61 @@
+#include "SymbolTable.h"
+#include "Macros.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace minirisk {
+
+namespace {
+
+struct SymbolTable
+{
+    std::mutex m_mutex;
+    std::unordered_map<string, symbol_t> m_ids;
+    std::deque<string> m_names;  // references to elements are never invalidated by push_back
+};
+
+// constructed on first use, so that it can be used during static initialization
+SymbolTable& symbol_table()
+{
+    static SymbolTable table;
+    return table;
+}
+
+} // anonymous namespace
+
+symbol_t intern(const string& name)
+{
+    SymbolTable& table = symbol_table();
+    std::lock_guard<std::mutex> lock(table.m_mutex);
+    auto ins = table.m_ids.emplace(name, static_cast<symbol_t>(table.m_names.size()));
+    if (ins.second)
+        table.m_names.push_back(name);
+    return ins.first->second;
+}
+
+symbol_t find_symbol(const string& name)
+{
+    SymbolTable& table = symbol_table();
+    std::lock_guard<std::mutex> lock(table.m_mutex);
+    auto iter = table.m_ids.find(name);
+    return iter != table.m_ids.end() ? iter->second : null_symbol;
+}
+
+const string& symbol_name(symbol_t id)
+{
+    SymbolTable& table = symbol_table();
+    std::lock_guard<std::mutex> lock(table.m_mutex);
+    MYASSERT(id < table.m_names.size(), "Unknown symbol " << id);
+    return table.m_names[id];
+}
+
+size_t symbol_count()
+{
+    SymbolTable& table = symbol_table();
+    std::lock_guard<std::mutex> lock(table.m_mutex);
+    return table.m_names.size();
+}
+
+} // namespace minirisk
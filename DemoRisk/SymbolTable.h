@@ -0,0 +1,29 @@
+#pragma once
+
+#include <limits>
+
+#include "Global.h"
+
+namespace minirisk {
+
+// Dense integer identifier of an interned name (risk factor, curve, ...).
+// Identifiers are assigned sequentially starting from 0, so that they can be used as
+// indices into flat arrays instead of looking up string keys.
+typedef unsigned symbol_t;
+
+// identifier not associated to any name
+const symbol_t null_symbol = std::numeric_limits<symbol_t>::max();
+
+// return the identifier of a name, registering it if necessary (thread safe)
+symbol_t intern(const string& name);
+
+// return the identifier of a name, or null_symbol if it was never interned (thread safe)
+symbol_t find_symbol(const string& name);
+
+// return the name associated to an identifier (thread safe)
+const string& symbol_name(symbol_t id);
+
+// number of names interned so far (thread safe)
+size_t symbol_count();
+
+} // namespace minirisk
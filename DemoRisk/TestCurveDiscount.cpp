@@ -0,0 +1,104 @@
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "Market.h"
+#include "CurveDiscount.h"
+
+using namespace minirisk;
+
+// Usage: TestCurveDiscount [risk_factors.txt]
+// (by default the file in the current directory, i.e. run it from the DemoRisk directory)
+string risk_factors_file = "risk_factors_5.txt";
+
+std::shared_ptr<const MarketDataServer> mds;
+
+// number of days of the last pillar (10Y)
+const unsigned last = 10 * 365;
+
+std::shared_ptr<const CurveDiscount> discount_curve(Market& mkt, const string& ccy)
+{
+    auto curve = std::dynamic_pointer_cast<const CurveDiscount>(mkt.get_discount_curve(ir_curve_discount_name(ccy)));
+    if (!curve)
+        throw std::runtime_error("Discount curve of " + ccy + " is not a CurveDiscount.");
+    return curve;
+}
+
+// same discount factors, bit for bit, at every day of the curve range, with the scalar and the
+// vector interface
+bool same_curve(const CurveDiscount& a, const CurveDiscount& b)
+{
+    const Date today = a.today();
+    std::vector<Date> t;
+    for (unsigned d = 0; d <= last; ++d)
+        t.push_back(Date(today.get_m_serial() + d));
+    std::vector<double> dfa(t.size()), dfb(t.size());
+    a.df(t.data(), dfa.data(), t.size());
+    b.df(t.data(), dfb.data(), t.size());
+    for (size_t i = 0; i < t.size(); ++i)
+        if (a.df(t[i]) != b.df(t[i]) || dfa[i] != dfb[i] || dfa[i] != a.df(t[i]))
+            return false;
+    return true;
+}
+
+// Bumping one pillar of a curve gives the same discount factors as rebuilding the curve from
+// the modified rate, for every pillar, including the first and the last one
+void test1()
+{
+    const Date today(2017, 8, 5);
+    Market mkt(mds, today);
+    for (const char *ccy : { "EUR", "USD" }) {
+        const std::shared_ptr<const CurveDiscount> base = discount_curve(mkt, ccy);
+        const Market::vec_risk_factor_t rates = mkt.get_ir_risk_factors(ccy);
+
+        for (const auto& rf : rates) {
+            const double rate = rf.second + 0.0123;
+            std::shared_ptr<const CurveDiscount> bumped = base->bump(rf.first, rate);
+
+            Market rebuilt_mkt(mds, today);
+            discount_curve(rebuilt_mkt, ccy);
+            rebuilt_mkt.set_risk_factors({ { rf.first, rate } });
+            std::shared_ptr<const CurveDiscount> rebuilt = discount_curve(rebuilt_mkt, ccy);
+
+            if (!bumped || !same_curve(*bumped, *rebuilt))
+                throw std::runtime_error("Test 1 failed: bumped curve differs from the rebuilt curve for " + symbol_name(rf.first));
+            if (same_curve(*bumped, *base))
+                throw std::runtime_error("Test 1 failed: bump of " + symbol_name(rf.first) + " has no effect.");
+        }
+    }
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// A bumped curve can be bumped again on the same pillar, but not on another one, and risk
+// factors which are not pillars of the curve leave it unchanged
+void test2()
+{
+    const Date today(2017, 8, 5);
+    Market mkt(mds, today);
+    const std::shared_ptr<const CurveDiscount> base = discount_curve(mkt, "EUR");
+    const symbol_t r1y = intern("IR.1Y.EUR"), r2y = intern("IR.2Y.EUR");
+
+    std::shared_ptr<const CurveDiscount> bumped = base->bump(r1y, 0.07);
+    std::shared_ptr<const CurveDiscount> twice = bumped->bump(r1y, 0.08);
+    if (!twice || !same_curve(*twice, *base->bump(r1y, 0.08)))
+        throw std::runtime_error("Test 2 failed: curve bumped twice on the same pillar.");
+    if (bumped->bump(r2y, 0.08))
+        throw std::runtime_error("Test 2 failed: curve bumped on two pillars.");
+    if (!same_curve(*base->bump(intern("IR.1Y.USD"), 0.5), *base))
+        throw std::runtime_error("Test 2 failed: curve modified by a risk factor of another currency.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    if (argc > 1)
+        risk_factors_file = argv[1];
+    mds.reset(new MarketDataServer(risk_factors_file));
+
+    test1();
+    test2();
+    return 0;
+}
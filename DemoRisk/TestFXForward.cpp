@@ -0,0 +1,146 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "MarketDataServer.h"
+#include "FixingDataServer.h"
+#include "PortfolioUtils.h"
+#include "PortfolioBatch.h"
+#include "ThreadPool.h"
+#include "TradeFXForward.h"
+
+using namespace minirisk;
+
+// Usage: TestFXForward [risk_factors.txt] [fixings.txt]
+// (by default the files in the current directory, i.e. run it from the DemoRisk directory)
+string risk_factors_file = "risk_factors_5.txt";
+string fixings_file = "fixings.txt";
+
+// FX forwards fixed before today, today and after today. The fixing of EUR.USD on today is
+// published, the one of USD.JPY is not.
+portfolio_t make_portfolio(const Date& today)
+{
+    portfolio_t portfolio;
+    auto add = [&portfolio](const string& base, const string& quote, double strike, const Date& fixing) {
+        auto trd = new TradeFXForward;
+        trd->init(base, quote, 100.0, strike, fixing, Date(2017, 8, 10));
+        portfolio.emplace_back(trd);
+    };
+    add("EUR", "USD", 1.1, today);             // 0: published fixing of today
+    add("USD", "JPY", 100.0, today);           // 1: fixing of today not published yet
+    add("EUR", "USD", 1.1, Date(2017, 8, 1));  // 2: past fixing not available
+    add("EUR", "USD", 1.1, Date(2017, 8, 8));  // 3: future fixing
+    return portfolio;
+}
+
+// A fixing dated today is taken from the fixings when published, otherwise from the market.
+// A fixing dated before today must be published.
+void test1(const std::vector<ppricer_t>& pricers, Market& mkt)
+{
+    portfolio_values_t prices = compute_prices(pricers, mkt);
+
+    const Date today = mkt.today();
+    double df = mkt.get_discount_curve(intern(ir_curve_discount_name("USD")))->df(Date(2017, 8, 10));
+    double expected = 100.0 * ((mkt.get_fixing(intern("FX.SPOT.EUR.USD"), today) - 1.1) * df);
+    if (is_error(prices[0]) || prices[0].first != expected)
+        throw std::runtime_error("Test 1 failed: FX forward fixed today is not priced with the historical fixing.");
+    if (is_error(prices[1]) || is_error(prices[3]))
+        throw std::runtime_error("Test 1 failed: FX forward not fixed yet is not priced with the forward curve.");
+    if (!is_error(prices[2]))
+        throw std::runtime_error("Test 1 failed: missing past fixing not reported.");
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// The batch pricer applies the same rule, with identical results
+void test2(const portfolio_t& portfolio, const std::vector<ppricer_t>& pricers, Market& mkt)
+{
+    portfolio_values_t prices = compute_prices(pricers, mkt);
+    portfolio_values_t batch = PortfolioBatch(portfolio, "USD").price(mkt);
+    for (size_t i = 0; i < prices.size(); ++i)
+        if (is_error(batch[i]) ? batch[i].second != prices[i].second : batch[i].first != prices[i].first)
+            throw std::runtime_error("Test 2 failed: batch price differs from the price of the individual pricer.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+// The historical fixing is not a risk factor: an FX forward fixed today has no FX delta
+void test3(const std::vector<ppricer_t>& pricers, const Market& mkt)
+{
+    ThreadPool pool(1);
+    for (const auto& deltas : { compute_fx_delta(pricers, mkt, pool), compute_fx_delta_analytic(pricers, mkt) }) {
+        for (const auto& d : deltas) {
+            if (is_error(d.second[0]) || d.second[0].first != 0.0)
+                throw std::runtime_error("Test 3 failed: FX forward fixed today has " + d.first);
+            if (d.first.ends_with("FX.SPOT.JPY") && (is_error(d.second[1]) || d.second[1].first == 0.0))
+                throw std::runtime_error("Test 3 failed: FX forward not fixed yet has no " + d.first);
+        }
+    }
+
+    std::cout << "Test 3: SUCCESS" << std::endl;
+}
+
+// A portfolio of FX forwards not fixed yet, priced from a new market in concurrent mode: all the
+// names the forward curve depends on are interned by the pricers, before the market is made
+// concurrent, and the prices and FX deltas do not depend on the number of threads.
+void test4(const std::shared_ptr<const MarketDataServer>& mds, const Date& today)
+{
+    const char *names[] = { "FX.FWD.GBP.JPY", "IR.DISCOUNT.GBP", "IR.DISCOUNT.JPY", "FX.SPOT.GBP.JPY" };
+    if (find_symbol(names[0]) != null_symbol)
+        throw std::runtime_error("Test 4 failed: forward curve name already interned.");
+
+    portfolio_t portfolio;
+    for (int i = 0; i < 3; ++i) {
+        auto trd = new TradeFXForward;
+        trd->init("GBP", "JPY", 100.0, 140.0 + i, Date(2017, 9, 1 + i), Date(2017, 9, 5 + i));
+        portfolio.emplace_back(trd);
+    }
+    std::vector<ppricer_t> pricers(get_pricers(portfolio, "USD"));
+    for (const char *name : names)
+        if (find_symbol(name) == null_symbol)
+            throw std::runtime_error(string("Test 4 failed: name not interned by the pricers: ") + name);
+
+    portfolio_values_t expected;
+    for (unsigned n_threads : { 1, 4 }) {
+        ThreadPool pool(n_threads);
+        for (bool batch : { false, true }) {
+            Market mkt(mds, today);
+            portfolio_values_t prices = batch
+                ? PortfolioBatch(portfolio, "USD").price(mkt, pool)
+                : compute_prices(pricers, mkt, pool);
+            if (expected.empty())
+                expected = prices;
+            for (size_t i = 0; i < prices.size(); ++i)
+                if (is_error(prices[i]) || prices[i].first != expected[i].first)
+                    throw std::runtime_error("Test 4 failed: FX forward not priced with " + std::to_string(n_threads) + " threads: " + prices[i].second);
+
+            for (const auto& d : compute_fx_delta(pricers, mkt, pool))
+                for (const auto& v : d.second)
+                    if (is_error(v))
+                        throw std::runtime_error("Test 4 failed: " + d.first + " not computed: " + v.second);
+        }
+    }
+
+    std::cout << "Test 4: SUCCESS" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    if (argc > 1)
+        risk_factors_file = argv[1];
+    if (argc > 2)
+        fixings_file = argv[2];
+
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
+    std::shared_ptr<const FixingDataServer> fds(new FixingDataServer(fixings_file));
+    Market mkt(mds, Date(2017, 8, 5), fds);
+
+    portfolio_t portfolio = make_portfolio(mkt.today());
+    std::vector<ppricer_t> pricers(get_pricers(portfolio, "USD"));
+
+    test1(pricers, mkt);
+    test2(portfolio, pricers, mkt);
+    test3(pricers, mkt);
+    test4(mds, mkt.today());
+    return 0;
+}
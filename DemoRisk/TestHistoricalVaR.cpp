@@ -0,0 +1,128 @@
+#include <iostream>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+
+#include "MarketDataServer.h"
+#include "HistoricalVaR.h"
+#include "Market.h"
+#include "ThreadPool.h"
+#include "TradePayment.h"
+
+using namespace minirisk;
+
+// Usage: TestHistoricalVaR [risk_factors.txt]
+// (by default the file in the current directory, i.e. run it from the DemoRisk directory)
+string risk_factors_file = "risk_factors_5.txt";
+
+const string history_file = "test_historical_var.tmp";
+
+// 11 days of FX.SPOT.EUR, i.e. 10 scenarios with returns +2%, -2.94%, +1.01%, -5%, +2.11%,
+// 0%, +4.12%, -2.97%, +2.04%, +3%. IR rates are not in the history, hence not shocked.
+void write_history()
+{
+    const double spot[] = { 1.00, 1.02, 0.99, 1.00, 0.95, 0.97, 0.97, 1.01, 0.98, 1.00, 1.03 };
+    std::ofstream of(history_file);
+    for (int d = 0; d < 11; ++d)
+        of << "FX.SPOT.EUR " << 20170701 + d << " " << spot[d] << "\n";
+}
+
+// A EUR payment delivered today worth 1000 USD, whose P&L is 1000 times the return of the spot,
+// a USD payment which is not affected by the scenarios, and a payment in the past which cannot
+// be priced
+portfolio_t make_portfolio(const Date& today, double spot_eur)
+{
+    portfolio_t portfolio;
+    auto add = [&portfolio](const string& ccy, double quantity, const Date& delivery) {
+        auto trd = new TradePayment;
+        trd->init(ccy, quantity, delivery);
+        portfolio.emplace_back(trd);
+    };
+    add("EUR", 1000.0 / spot_eur, today);
+    add("USD", 500.0, Date(2019, 1, 15));
+    add("EUR", 100.0, Date(2017, 8, 1));
+    return portfolio;
+}
+
+bool nearly_equal(double a, double b)
+{
+    return std::abs(a - b) <= 1e-8;
+}
+
+// At 80% confidence the tail is made of the 2 worst of the 10 scenarios: -5% on 5-7-2017 and
+// -2.97% on 9-7-2017, so that VaR = 1000 * 0.03 / 1.01 and ES = (50 + VaR) / 2
+void test1(const std::vector<ppricer_t>& pricers, const Market& mkt, const RiskFactorHistory& history)
+{
+    ThreadPool pool(1);
+    historical_var_t res = compute_historical_var(pricers, mkt, history, 0.8, pool);
+
+    const double var = 1000.0 * 0.03 / 1.01;
+    const double es = (50.0 + var) / 2.0;
+    if (res.n_scenarios != 10 || res.n_tail != 2)
+        throw std::runtime_error("Test 1 failed: unexpected number of scenarios.");
+    if (!nearly_equal(res.var, var) || !nearly_equal(res.es, es))
+        throw std::runtime_error("Test 1 failed: VaR " + std::to_string(res.var) + " and ES " + std::to_string(res.es)
+            + " instead of " + std::to_string(var) + " and " + std::to_string(es));
+    if (res.tail_dates.size() != 2 || !(res.tail_dates[0] == Date(2017, 7, 5)) || !(res.tail_dates[1] == Date(2017, 7, 9)))
+        throw std::runtime_error("Test 1 failed: unexpected tail scenarios.");
+
+    if (!nearly_equal(res.var_contributions[0].first, var) || !nearly_equal(res.es_contributions[0].first, es))
+        throw std::runtime_error("Test 1 failed: unexpected contributions of the EUR payment.");
+    if (res.var_contributions[1].first != 0.0 || res.es_contributions[1].first != 0.0)
+        throw std::runtime_error("Test 1 failed: USD payment contributes to the VaR.");
+    if (!is_error(res.var_contributions[2]) || !is_error(res.es_contributions[2]))
+        throw std::runtime_error("Test 1 failed: error of the payment in the past not reported.");
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// The results do not depend on the number of threads, invalid inputs are rejected
+void test2(const std::vector<ppricer_t>& pricers, const Market& mkt, const RiskFactorHistory& history)
+{
+    ThreadPool serial(1), pool(3);
+    for (double confidence : { 0.5, 0.8, 0.95 }) {
+        historical_var_t a = compute_historical_var(pricers, mkt, history, confidence, serial);
+        historical_var_t b = compute_historical_var(pricers, mkt, history, confidence, pool);
+        if (a.var != b.var || a.es != b.es || a.tail_dates.size() != b.tail_dates.size()
+            || a.var_contributions[0].first != b.var_contributions[0].first || a.es_contributions[0].first != b.es_contributions[0].first)
+            throw std::runtime_error("Test 2 failed: results depend on the number of threads.");
+    }
+
+    bool thrown = false;
+    try {
+        compute_historical_var(pricers, mkt, history, 1.0, serial);
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    if (!thrown)
+        throw std::runtime_error("Test 2 failed: invalid confidence level accepted.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    if (argc > 1)
+        risk_factors_file = argv[1];
+
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
+    Market mkt(mds, Date(2017, 8, 5));
+
+    portfolio_t portfolio = make_portfolio(mkt.today(), mkt.get_fx_spot("FX.SPOT.EUR.USD"));
+    std::vector<ppricer_t> pricers(get_pricers(portfolio, "USD"));
+
+    // fetch the risk factors the portfolio depends on, as DemoRisk does
+    compute_prices(pricers, mkt);
+    mkt.disconnect();
+
+    write_history();
+    RiskFactorHistory history(history_file);
+
+    test1(pricers, mkt, history);
+    test2(pricers, mkt, history);
+    std::remove(history_file.c_str());
+    return 0;
+}
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "Market.h"
+#include "ThreadPool.h"
+
+using namespace minirisk;
+
+// Usage: TestMarket [risk_factors.txt]
+// (by default the file in the current directory, i.e. run it from the DemoRisk directory)
+string risk_factors_file = "risk_factors_5.txt";
+
+std::shared_ptr<const MarketDataServer> mds;
+
+// In concurrent mode each curve is built once and shared by all threads, including curves whose
+// name is interned after the market was made concurrent. Such curves are merged into the base
+// snapshot, with their dependencies, when leaving concurrent mode.
+void test1()
+{
+    const Date today(2017, 8, 5);
+    const Date t(2019, 1, 15);
+    const string disc_name = "IR.DISCOUNT.JPY", fwd_name = "FX.FWD.GBP.JPY";
+    if (find_symbol(disc_name) != null_symbol || find_symbol(fwd_name) != null_symbol)
+        throw std::runtime_error("Test 1 failed: curve names already interned.");
+
+    Market mkt(mds, today);
+    ThreadPool pool(4);
+    std::vector<const void *> disc(64), fwd(64);
+    {
+        ConcurrentMarketScope scope(mkt);
+        if (!scope.concurrent())
+            throw std::runtime_error("Test 1 failed: market not concurrent.");
+        pool.parallel_for(disc.size(), 1, [&](size_t begin, size_t end, unsigned) {
+            for (size_t i = begin; i < end; ++i) {
+                disc[i] = mkt.get_discount_curve(disc_name).get();
+                fwd[i] = mkt.get_fx_forward_curve(intern(fwd_name)).get();
+            }
+        });
+    }
+    for (size_t i = 1; i < disc.size(); ++i)
+        if (disc[i] != disc[0] || fwd[i] != fwd[0])
+            throw std::runtime_error("Test 1 failed: curve built more than once in concurrent mode.");
+
+    // merged into the base snapshot
+    ptr_disc_curve_t d = mkt.get_discount_curve(disc_name);
+    if (d.get() != disc[0] || mkt.get_fx_forward_curve(intern(fwd_name)).get() != fwd[0])
+        throw std::runtime_error("Test 1 failed: late curve not merged into the base snapshot.");
+
+    // same values as a market used serially
+    Market serial(mds, today);
+    if (d->df(t) != serial.get_discount_curve(disc_name)->df(t)
+        || mkt.get_fx_forward_curve(intern(fwd_name))->fwd(t) != serial.get_fx_forward_curve(intern(fwd_name))->fwd(t))
+        throw std::runtime_error("Test 1 failed: values differ from the serial market.");
+
+    // the dependencies are merged as well: a modified risk factor invalidates the curve
+    mkt.set_risk_factors({ { intern("IR.1Y.JPY"), 0.01 } });
+    if (mkt.get_discount_curve(disc_name).get() == disc[0] || mkt.get_fx_forward_curve(intern(fwd_name)).get() == fwd[0])
+        throw std::runtime_error("Test 1 failed: late curve not invalidated by its risk factors.");
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// A copy of a market shares its base snapshot: modifying the risk factors of the copy only
+// rebuilds the curves depending on them, and never modifies the original market, and vice versa
+void test2()
+{
+    const Date today(2017, 8, 5);
+    const Date t(2019, 1, 15);
+    const symbol_t eur = intern("IR.DISCOUNT.EUR"), usd = intern("IR.DISCOUNT.USD");
+    const symbol_t rate_eur = intern("IR.1Y.EUR"), rate_usd = intern("IR.1Y.USD");
+
+    Market mkt(mds, today);
+    const ptr_disc_curve_t eur0 = mkt.get_discount_curve(eur), usd0 = mkt.get_discount_curve(usd);
+    const double df_eur = eur0->df(t), df_usd = usd0->df(t);
+    const Market::vec_risk_factor_t base_eur = mkt.get_risk_factors("IR\\.1Y\\.EUR");
+    if (base_eur.size() != 1)
+        throw std::runtime_error("Test 2 failed: risk factor IR.1Y.EUR not fetched.");
+
+    Market copy(mkt);
+    if (copy.get_discount_curve(eur) != eur0 || copy.get_discount_curve(usd) != usd0)
+        throw std::runtime_error("Test 2 failed: curves of the base snapshot not shared by the copy.");
+
+    copy.set_risk_factors({ { rate_eur, base_eur[0].second + 0.01 } });
+    if (copy.get_discount_curve(eur)->df(t) == df_eur || copy.get_discount_curve(usd) != usd0)
+        throw std::runtime_error("Test 2 failed: copy not rebuilding exactly the curves depending on the modified risk factor.");
+    if (copy.get_risk_factors("IR\\.1Y\\.EUR")[0].second != base_eur[0].second + 0.01)
+        throw std::runtime_error("Test 2 failed: modified risk factor not visible in the copy.");
+    if (mkt.get_discount_curve(eur) != eur0 || eur0->df(t) != df_eur
+        || mkt.get_risk_factors("IR\\.1Y\\.EUR")[0].second != base_eur[0].second)
+        throw std::runtime_error("Test 2 failed: original market modified through its copy.");
+
+    copy.set_risk_factors(base_eur);
+    if (copy.get_discount_curve(eur)->df(t) != df_eur)
+        throw std::runtime_error("Test 2 failed: curve not restored with the risk factor.");
+
+    // the original market copies its base snapshot before modifying it
+    mkt.set_risk_factors({ { rate_usd, 0.2 } });
+    if (mkt.get_discount_curve(usd)->df(t) == df_usd || copy.get_discount_curve(usd) != usd0 || usd0->df(t) != df_usd)
+        throw std::runtime_error("Test 2 failed: copy modified through the original market.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+// Curves destroyed by a modified risk factor are cached: restoring the values they were built
+// from gives back the identical curves, both in a market owning its base snapshot and in a copy
+void test3()
+{
+    const Date today(2017, 8, 5);
+    const Date t(2019, 1, 15);
+    const symbol_t fwd = intern("FX.FWD.EUR.USD"), rate = intern("IR.1Y.EUR");
+
+    Market mkt(mds, today);
+    const ptr_fwd_curve_t fwd0 = mkt.get_fx_forward_curve(fwd);
+    const Market::vec_risk_factor_t base = mkt.get_risk_factors("IR\\.1Y\\.EUR");
+    if (base.size() != 1)
+        throw std::runtime_error("Test 3 failed: risk factor IR.1Y.EUR not fetched.");
+    const double r0 = base[0].second;
+
+    auto check = [&](Market& m) {
+        m.set_risk_factors({ { rate, r0 + 0.01 } });
+        const ptr_fwd_curve_t up = m.get_fx_forward_curve(fwd);
+        if (up == fwd0 || up->fwd(t) == fwd0->fwd(t))
+            throw std::runtime_error("Test 3 failed: curve not rebuilt after a modified risk factor.");
+
+        m.set_risk_factors({ { rate, r0 } });
+        if (m.get_fx_forward_curve(fwd) != fwd0)
+            throw std::runtime_error("Test 3 failed: original curve not restored.");
+
+        m.set_risk_factors({ { rate, r0 + 0.01 } });
+        if (m.get_fx_forward_curve(fwd) != up)
+            throw std::runtime_error("Test 3 failed: cached curve not reused.");
+
+        // a value never seen before is not served from the cache
+        m.set_risk_factors({ { rate, r0 + 0.02 } });
+        const ptr_fwd_curve_t up2 = m.get_fx_forward_curve(fwd);
+        if (up2 == up || up2 == fwd0 || up2->fwd(t) == up->fwd(t))
+            throw std::runtime_error("Test 3 failed: stale curve returned by the cache.");
+
+        m.set_risk_factors({ { rate, r0 } });
+        if (m.get_fx_forward_curve(fwd) != fwd0)
+            throw std::runtime_error("Test 3 failed: original curve not restored.");
+    };
+
+    check(mkt);
+    Market copy(mkt);
+    check(copy);
+
+    std::cout << "Test 3: SUCCESS" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    if (argc > 1)
+        risk_factors_file = argv[1];
+    mds.reset(new MarketDataServer(risk_factors_file));
+
+    test1();
+    test2();
+    test3();
+    return 0;
+}
@@ -0,0 +1,169 @@
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+
+#include "MarketDataServer.h"
+#include "PortfolioUtils.h"
+#include "ThreadPool.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+
+using namespace minirisk;
+
+// Usage: TestPV01 [risk_factors.txt]
+// (by default the file in the current directory, i.e. run it from the DemoRisk directory)
+string risk_factors_file = "risk_factors_5.txt";
+
+typedef std::vector<std::pair<string, portfolio_values_t>> risk_t;
+
+// Payments in all currencies and FX forwards, with a payment in the past which cannot be priced
+portfolio_t make_portfolio()
+{
+    portfolio_t portfolio;
+    const char *ccys[] = { "EUR", "GBP", "JPY", "USD" };
+    for (int i = 0; i < 40; ++i) {
+        auto trd = new TradePayment;
+        trd->init(ccys[i % 4], 1000.0 * (i + 1), Date(2017 + i % 9, 1 + i % 12, 1 + i % 28));
+        portfolio.emplace_back(trd);
+    }
+    auto past = new TradePayment;
+    past->init("EUR", 1000.0, Date(2017, 8, 1));
+    portfolio.emplace_back(past);
+    for (int i = 0; i < 6; ++i) {
+        auto trd = new TradeFXForward;
+        trd->init(i % 2 ? "GBP" : "EUR", i % 2 ? "JPY" : "USD", 100.0, i % 2 ? 160.0 : 1.1
+            , Date(2018 + i, 3, 1), Date(2018 + i, 3, 5));
+        portfolio.emplace_back(trd);
+    }
+    return portfolio;
+}
+
+// same values and same errors, bit for bit
+bool same_risk(const risk_t& a, const risk_t& b)
+{
+    if (a.size() != b.size())
+        return false;
+    for (size_t k = 0; k < a.size(); ++k) {
+        if (a[k].first != b[k].first || a[k].second.size() != b[k].second.size())
+            return false;
+        for (size_t i = 0; i < a[k].second.size(); ++i) {
+            const trade_value_t& x = a[k].second[i];
+            const trade_value_t& y = b[k].second[i];
+            if (is_error(x) ? x.second != y.second : (is_error(y) || x.first != y.first))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Bucketed and parallel PV01 do not depend on the number of threads
+void test1(const std::vector<ppricer_t>& pricers, const Market& mkt)
+{
+    ThreadPool serial(1);
+    const risk_t bucketed = compute_pv01_bucketed(pricers, mkt, serial);
+    const risk_t parallel = compute_pv01_parallel(pricers, mkt, serial);
+    if (bucketed.size() != 40 || parallel.size() != 4)
+        throw std::runtime_error("Test 1 failed: unexpected number of risk factors.");
+
+    for (unsigned n_threads : { 2, 3, 8 }) {
+        ThreadPool pool(n_threads);
+        if (!same_risk(bucketed, compute_pv01_bucketed(pricers, mkt, pool)))
+            throw std::runtime_error("Test 1 failed: bucketed PV01 differs with " + std::to_string(n_threads) + " threads.");
+        if (!same_risk(parallel, compute_pv01_parallel(pricers, mkt, pool)))
+            throw std::runtime_error("Test 1 failed: parallel PV01 differs with " + std::to_string(n_threads) + " threads.");
+    }
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Repricing only the trades depending on the bumped risk factor gives the same bucketed PV01 as
+// repricing the whole portfolio, with fewer repricings
+void test2(const std::vector<ppricer_t>& pricers, const Market& mkt)
+{
+    const double bump_size = 0.01 / 100;
+    ThreadPool pool(1);
+    size_t n_reprices = 0;
+    const risk_t bucketed = compute_pv01_bucketed(pricers, mkt, pool, &n_reprices);
+
+    // full repricing, as in the original implementation
+    risk_t full;
+    Market tmpmkt(mkt);
+    for (const auto& d : mkt.get_risk_factors(RiskFactorKey::ir_rate)) {
+        Market::vec_risk_factor_t bumped(1, d);
+        bumped[0].second = d.second - bump_size;
+        tmpmkt.set_risk_factors(bumped);
+        portfolio_values_t pv_dn = compute_prices(pricers, tmpmkt);
+        bumped[0].second = d.second + bump_size;
+        tmpmkt.set_risk_factors(bumped);
+        portfolio_values_t pv_up = compute_prices(pricers, tmpmkt);
+        tmpmkt.set_risk_factors({ d });
+
+        full.push_back(std::make_pair("bucketed " + symbol_name(d.first), portfolio_values_t()));
+        for (size_t i = 0; i < pricers.size(); ++i)
+            full.back().second.push_back(is_error(pv_dn[i]) ? pv_dn[i]
+                : is_error(pv_up[i]) ? pv_up[i]
+                : trade_value((pv_up[i].first - pv_dn[i].first) / (2.0 * bump_size)));
+    }
+
+    if (!same_risk(bucketed, full))
+        throw std::runtime_error("Test 2 failed: PV01 differs from the one of the full repricing.");
+    if (n_reprices >= 2 * full.size() * pricers.size())
+        throw std::runtime_error("Test 2 failed: " + std::to_string(n_reprices) + " repricings, not less than the full repricing.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+// The analytic PV01 matches the finite differences, up to the truncation error of the central
+// differences, and reports the same errors
+void test3(const std::vector<ppricer_t>& pricers, const Market& mkt)
+{
+    ThreadPool pool(1);
+    risk_t bucketed, parallel;
+    compute_pv01_analytic(pricers, mkt, bucketed, parallel);
+
+    for (const auto& r : { std::make_pair(&bucketed, compute_pv01_bucketed(pricers, mkt, pool))
+                         , std::make_pair(&parallel, compute_pv01_parallel(pricers, mkt, pool)) }) {
+        const risk_t& analytic = *r.first;
+        const risk_t& fd = r.second;
+        if (analytic.size() != fd.size())
+            throw std::runtime_error("Test 3 failed: different risk factors.");
+        for (size_t k = 0; k < fd.size(); ++k) {
+            if (analytic[k].first != fd[k].first)
+                throw std::runtime_error("Test 3 failed: " + analytic[k].first + " instead of " + fd[k].first);
+            for (size_t i = 0; i < pricers.size(); ++i) {
+                const trade_value_t& a = analytic[k].second[i];
+                const trade_value_t& f = fd[k].second[i];
+                if (is_error(a) != is_error(f))
+                    throw std::runtime_error("Test 3 failed: error reported by one method only for " + fd[k].first);
+                if (!is_error(f) && std::abs(a.first - f.first) > 1e-6 * std::max(std::abs(f.first), 1.0))
+                    throw std::runtime_error("Test 3 failed: " + fd[k].first + " of trade " + std::to_string(i)
+                        + " is " + std::to_string(a.first) + " instead of " + std::to_string(f.first));
+            }
+        }
+    }
+
+    std::cout << "Test 3: SUCCESS" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    if (argc > 1)
+        risk_factors_file = argv[1];
+
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
+    Market mkt(mds, Date(2017, 8, 5));
+
+    portfolio_t portfolio = make_portfolio();
+    std::vector<ppricer_t> pricers(get_pricers(portfolio, "USD"));
+
+    // fetch the risk factors the portfolio depends on, as DemoRisk does
+    compute_prices(pricers, mkt);
+    mkt.disconnect();
+
+    test1(pricers, mkt);
+    test2(pricers, mkt);
+    test3(pricers, mkt);
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <stdexcept>
+#include <cmath>
+#include <limits>
+
+#include "MarketDataServer.h"
+#include "PortfolioUtils.h"
+#include "PortfolioBatch.h"
+#include "ThreadPool.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+
+using namespace minirisk;
+
+// Usage: TestPortfolioBatch [risk_factors.txt]
+// (by default the file in the current directory, i.e. run it from the DemoRisk directory)
+string risk_factors_file = "risk_factors_5.txt";
+
+const double not_a_number = std::numeric_limits<double>::quiet_NaN();
+
+// Payments and FX forwards in several currencies, in an arbitrary order, including trades which
+// cannot be priced: payments in the past or beyond the last tenor, and trades whose price is NaN
+portfolio_t make_portfolio()
+{
+    portfolio_t portfolio;
+    const char *ccys[] = { "EUR", "GBP", "JPY", "USD" };
+    for (int i = 0; i < 600; ++i) {
+        if (i % 5 == 4) {
+            auto trd = new TradeFXForward;
+            trd->init(ccys[i % 4], ccys[(i + 1) % 4], 100.0, 1.0 + i % 3, Date(2017 + i % 7, 1 + i % 12, 10), Date(2017 + i % 7, 1 + i % 12, 14));
+            portfolio.emplace_back(trd);
+        }
+        else {
+            auto trd = new TradePayment;
+            trd->init(ccys[i % 4], 10.0 * i, Date(2017 + i % 11, 1 + i % 12, 1 + i % 28));
+            portfolio.emplace_back(trd);
+        }
+    }
+    auto nan_payment = new TradePayment;
+    nan_payment->init("EUR", not_a_number, Date(2018, 1, 1));
+    portfolio.emplace_back(nan_payment);
+    auto nan_forward = new TradeFXForward;
+    nan_forward->init("EUR", "USD", 100.0, not_a_number, Date(2018, 1, 1), Date(2018, 1, 3));
+    portfolio.emplace_back(nan_forward);
+    return portfolio;
+}
+
+// same values and same errors, bit for bit, and a valid value is never NaN
+void check_same(const portfolio_values_t& batch, const portfolio_values_t& scalar, const string& test)
+{
+    if (batch.size() != scalar.size())
+        throw std::runtime_error(test + " failed: different number of prices.");
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (is_error(batch[i]) != is_error(scalar[i])
+            || (is_error(batch[i]) ? batch[i].second != scalar[i].second : batch[i].first != scalar[i].first))
+            throw std::runtime_error(test + " failed: batch price of trade " + std::to_string(i) + " differs from the individual pricer.");
+        if (!is_error(batch[i]) && std::isnan(batch[i].first))
+            throw std::runtime_error(test + " failed: NaN price of trade " + std::to_string(i) + " reported as valid.");
+    }
+}
+
+// The batch pricer gives the same prices and errors as the individual pricers, in the order of
+// the portfolio, for several base currencies
+void test1(const portfolio_t& portfolio, const std::shared_ptr<const MarketDataServer>& mds)
+{
+    for (const char *base_ccy : { "USD", "GBP" }) {
+        Market mkt(mds, Date(2017, 8, 5));
+        portfolio_values_t batch = PortfolioBatch(portfolio, base_ccy).price(mkt);
+        portfolio_values_t scalar = compute_prices(get_pricers(portfolio, base_ccy), mkt);
+        check_same(batch, scalar, "Test 1");
+
+        const size_t n = portfolio.size();
+        if (batch[n - 2].second != "Price is not a number" || batch[n - 1].second != "Price is not a number")
+            throw std::runtime_error("Test 1 failed: NaN prices not reported as errors.");
+        if (portfolio_total(batch).second == n)
+            throw std::runtime_error("Test 1 failed: no trade priced.");
+    }
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Same results when the groups are priced in parallel
+void test2(const portfolio_t& portfolio, const std::shared_ptr<const MarketDataServer>& mds)
+{
+    ThreadPool pool(4);
+    Market mkt(mds, Date(2017, 8, 5));
+    portfolio_values_t batch = PortfolioBatch(portfolio, "USD").price(mkt, pool);
+    Market serial(mds, Date(2017, 8, 5));
+    check_same(batch, compute_prices(get_pricers(portfolio, "USD"), serial), "Test 2");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+
+int main(int argc, const char **argv)
+{
+    if (argc > 1)
+        risk_factors_file = argv[1];
+
+    std::shared_ptr<const MarketDataServer> mds(new MarketDataServer(risk_factors_file));
+    portfolio_t portfolio = make_portfolio();
+
+    test1(portfolio, mds);
+    test2(portfolio, mds);
+    return 0;
+}
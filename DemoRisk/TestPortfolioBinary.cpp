@@ -0,0 +1,128 @@
+#include <iostream>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "PortfolioUtils.h"
+#include "PortfolioBinary.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+
+using namespace minirisk;
+
+const string binary_file = "test_portfolio_binary.tmp";
+const string text_file = "test_portfolio_text.tmp";
+
+// Payments and FX forwards interleaved, with quantities whose bits must be preserved
+portfolio_t make_portfolio()
+{
+    const double quantities[] = { 1.0, -0.0, 1.0 / 3.0, -1.5e+05, std::numeric_limits<double>::denorm_min() };
+    portfolio_t portfolio;
+    for (int i = 0; i < 50; ++i) {
+        if (i % 3 == 2) {
+            auto trd = new TradeFXForward;
+            trd->init("EUR", "JPY", quantities[i % 5], 120.0 + i / 7.0, Date(2018, 1 + i % 12, 5), Date(2018, 1 + i % 12, 9));
+            portfolio.emplace_back(trd);
+        }
+        else {
+            auto trd = new TradePayment;
+            trd->init(i % 2 ? "USD" : "GBP", quantities[i % 5], Date(2017 + i % 10, 1 + i % 12, 1 + i % 28));
+            portfolio.emplace_back(trd);
+        }
+    }
+    return portfolio;
+}
+
+string read_file(const string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    std::ostringstream tmp;
+    tmp << is.rdbuf();
+    return tmp.str();
+}
+
+void write_file(const string& filename, const string& content)
+{
+    std::ofstream of(filename, std::ios::binary);
+    of.write(content.data(), content.size());
+}
+
+// text representation of a portfolio, where doubles are written bit for bit
+string to_text(const portfolio_t& portfolio)
+{
+    save_portfolio(text_file, portfolio);
+    return read_file(text_file);
+}
+
+// A portfolio saved in binary format is loaded back identical, in the same order, and the
+// format is detected automatically
+void test1()
+{
+    for (const portfolio_t& portfolio : { make_portfolio(), portfolio_t() }) {
+        save_portfolio_binary(binary_file, portfolio);
+        if (!is_portfolio_binary(binary_file))
+            throw std::runtime_error("Test 1 failed: binary format not detected.");
+
+        portfolio_t loaded = load_portfolio(binary_file);
+        if (loaded.size() != portfolio.size() || to_text(loaded) != to_text(portfolio))
+            throw std::runtime_error("Test 1 failed: portfolio not loaded back identical.");
+    }
+
+    if (is_portfolio_binary(text_file))
+        throw std::runtime_error("Test 1 failed: text file detected as binary.");
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Files with a corrupted header or section table are rejected with an error
+void test2()
+{
+    save_portfolio_binary(binary_file, make_portfolio());
+    const string good = read_file(binary_file);
+
+    // header: magic at 0, version at 4, number of trades at 8, number of sections at 16,
+    // followed by the section table, where the offset of the first section is at 24 + 16
+    auto patch = [&good](size_t offset, auto value) {
+        string tmp(good);
+        std::memcpy(&tmp[offset], &value, sizeof(value));
+        return tmp;
+    };
+    const std::pair<string, string> corrupted[] = {
+        { "magic", patch(0, uint32_t(0x46505258)) },
+        { "version", patch(4, uint32_t(99)) },
+        { "number of trades", patch(8, uint64_t(1) << 60) },
+        { "number of sections", patch(16, uint32_t(0xffffffff)) },
+        { "section offset", patch(24 + 16, uint64_t(1) << 40) },
+        { "truncated header", good.substr(0, 10) },
+        { "truncated records", good.substr(0, good.size() - 8) },
+    };
+
+    for (const auto& c : corrupted) {
+        write_file(binary_file, c.second);
+        bool thrown = false;
+        try {
+            load_portfolio_binary(binary_file);
+        }
+        catch (const std::exception&) {
+            thrown = true;
+        }
+        if (!thrown)
+            throw std::runtime_error("Test 2 failed: corrupted " + c.first + " accepted.");
+    }
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+
+int main()
+{
+    test1();
+    test2();
+    std::remove(binary_file.c_str());
+    std::remove(text_file.c_str());
+    return 0;
+}
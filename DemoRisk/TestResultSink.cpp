@@ -0,0 +1,160 @@
+#include <iostream>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "ResultSink.h"
+
+using namespace minirisk;
+
+const string tmp_file = "test_result_sink.tmp";
+
+string read_file(const string& filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    std::ostringstream tmp;
+    tmp << is.rdbuf();
+    return tmp.str();
+}
+
+// two results of three trades, one of which cannot be priced, with an error message to be quoted
+void write_results(IResultSink& sink)
+{
+    sink.write("PV", { trade_value(2.5), trade_error("Curve \"IR.DISCOUNT.XXX\" unknown, no data"), trade_value(1.0 / 3.0) });
+    sink.write("PV01 bucketed IR.1Y.EUR", { trade_value(-150000.0), trade_error("no data"), trade_value(1e-300) });
+}
+
+// The CSV sink writes one line per trade per result, values in their shortest representation
+// which round trips, and errors quoted when needed
+void test1()
+{
+    {
+        ResultSinkCSV sink(tmp_file);
+        write_results(sink);
+        sink.close();
+    }
+    const string expected =
+        "result,trade,value,error\n"
+        "PV,0,2.5,\n"
+        "PV,1,,\"Curve \"\"IR.DISCOUNT.XXX\"\" unknown, no data\"\n"
+        "PV,2,0.3333333333333333,\n"
+        "PV01 bucketed IR.1Y.EUR,0,-150000,\n"
+        "PV01 bucketed IR.1Y.EUR,1,,no data\n"
+        "PV01 bucketed IR.1Y.EUR,2,1e-300,\n";
+    if (read_file(tmp_file) != expected)
+        throw std::runtime_error("Test 1 failed: unexpected CSV content:\n" + read_file(tmp_file));
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Sequential reader of the binary results file
+struct reader_t
+{
+    const string& data;
+    size_t pos = 0;
+
+    template <typename T>
+    T pod()
+    {
+        if (pos + sizeof(T) > data.size())
+            throw std::runtime_error("Test 2 failed: unexpected end of file.");
+        T v;
+        std::memcpy(&v, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
+
+    string str()
+    {
+        uint32_t n = pod<uint32_t>();
+        if (pos + n > data.size())
+            throw std::runtime_error("Test 2 failed: unexpected end of file.");
+        pos += n;
+        return data.substr(pos - n, n);
+    }
+};
+
+// The binary sink writes the header, then one column per result with all values bit for bit,
+// NaN for the trades which cannot be priced, followed by the error messages
+void test2()
+{
+    {
+        ResultSinkBinary sink(tmp_file);
+        write_results(sink);
+        sink.close();
+    }
+    const string data = read_file(tmp_file);
+    reader_t r{ data };
+
+    if (data.compare(0, 4, "MRRS") != 0)
+        throw std::runtime_error("Test 2 failed: invalid magic.");
+    r.pos = 4;
+    if (r.pod<uint32_t>() != 1 || r.pod<uint64_t>() != 3)
+        throw std::runtime_error("Test 2 failed: invalid header.");
+
+    const char *names[] = { "PV", "PV01 bucketed IR.1Y.EUR" };
+    const double values[2][3] = { { 2.5, 0.0, 1.0 / 3.0 }, { -150000.0, 0.0, 1e-300 } };
+    const char *errors[] = { "Curve \"IR.DISCOUNT.XXX\" unknown, no data", "no data" };
+    for (size_t k = 0; k < 2; ++k) {
+        if (r.str() != names[k])
+            throw std::runtime_error("Test 2 failed: invalid name of column " + std::to_string(k));
+        for (size_t i = 0; i < 3; ++i) {
+            double v = r.pod<double>();
+            if (i == 1 ? !std::isnan(v) : v != values[k][i])
+                throw std::runtime_error("Test 2 failed: invalid value of trade " + std::to_string(i) + " in column " + names[k]);
+        }
+        if (r.pod<uint32_t>() != 1 || r.pod<uint32_t>() != 1 || r.str() != errors[k])
+            throw std::runtime_error("Test 2 failed: invalid errors in column " + string(names[k]));
+    }
+    if (r.pos != data.size())
+        throw std::runtime_error("Test 2 failed: unexpected data at the end of the file.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+// An empty binary file still has a header, results of the wrong size and unknown formats are
+// rejected
+void test3()
+{
+    make_result_sink(tmp_file, "bin")->close();
+    if (read_file(tmp_file).size() != 16)
+        throw std::runtime_error("Test 3 failed: invalid empty binary file.");
+
+    bool thrown = false;
+    try {
+        presult_sink_t sink = make_result_sink(tmp_file, "bin");
+        sink->write("PV", { trade_value(1.0) });
+        sink->write("PV01", { trade_value(1.0), trade_value(2.0) });
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    if (!thrown)
+        throw std::runtime_error("Test 3 failed: result of the wrong size accepted.");
+
+    thrown = false;
+    try {
+        make_result_sink(tmp_file, "xml");
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    if (!thrown)
+        throw std::runtime_error("Test 3 failed: unknown format accepted.");
+
+    std::cout << "Test 3: SUCCESS" << std::endl;
+}
+
+
+int main()
+{
+    test1();
+    test2();
+    test3();
+    std::remove(tmp_file.c_str());
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <stdexcept>
+
+#include "RiskCube.h"
+#include "TradePayment.h"
+#include "TradeFXForward.h"
+
+using namespace minirisk;
+
+portfolio_t make_portfolio()
+{
+    portfolio_t portfolio;
+    auto add_payment = [&portfolio](const string& ccy, const Date& delivery) {
+        auto trd = new TradePayment;
+        trd->init(ccy, 1.0, delivery);
+        portfolio.emplace_back(trd);
+    };
+    add_payment("EUR", Date(2017, 12, 1));    // 0: EUR Payment 0-1Y
+    add_payment("EUR", Date(2020, 1, 1));     // 1: EUR Payment 2Y-5Y
+    add_payment("USD", Date(2018, 6, 1));     // 2: USD Payment 0-1Y
+    auto fwd = new TradeFXForward;
+    fwd->init("EUR", "USD", 1.0, 1.1, Date(2018, 3, 1), Date(2018, 3, 5));
+    portfolio.emplace_back(fwd);              // 3: USD FX.Forward 0-1Y
+    add_payment("GBP", Date(2017, 8, 1));     // 4: GBP Payment expired
+    add_payment("EUR", Date(2030, 1, 1));     // 5: EUR Payment 10Y+
+    return portfolio;
+}
+
+// values 1, 2, 4, 8, 16, error, so that each bucket total identifies the trades it contains
+portfolio_values_t make_values()
+{
+    return { trade_value(1.0), trade_value(2.0), trade_value(4.0), trade_value(8.0), trade_value(16.0), trade_error("no price") };
+}
+
+// bucket with a given label, checking its value and number of errors in row r
+void check_bucket(const RiskCube& cube, size_t r, const string& label, double value, size_t errors, const string& test)
+{
+    for (size_t b = 0; b < cube.buckets(); ++b) {
+        if (cube.label(b) != label)
+            continue;
+        if (cube.value(r, b) != value || cube.errors(r, b) != errors)
+            throw std::runtime_error(test + " failed: bucket " + label + " of row " + cube.name(r) + " is " + std::to_string(cube.value(r, b))
+                + " with " + std::to_string(cube.errors(r, b)) + " errors");
+        return;
+    }
+    throw std::runtime_error(test + " failed: missing bucket " + label);
+}
+
+// Trades are assigned to the buckets of their currency and type, buckets are sorted by label
+// and errors are counted separately from the values
+void test1(const portfolio_t& portfolio, const Date& today)
+{
+    RiskCube cube(portfolio, today, parse_group_by("ccy,type"));
+    cube.add("PV", make_values());
+
+    const char *labels[] = { "EUR Payment", "GBP Payment", "USD FX.Forward", "USD Payment" };
+    if (cube.rows() != 1 || cube.buckets() != 4)
+        throw std::runtime_error("Test 1 failed: unexpected size of the cube.");
+    for (size_t b = 0; b < cube.buckets(); ++b)
+        if (cube.label(b) != labels[b])
+            throw std::runtime_error("Test 1 failed: bucket " + cube.label(b) + " instead of " + labels[b]);
+
+    check_bucket(cube, 0, "EUR Payment", 3.0, 1, "Test 1");
+    check_bucket(cube, 0, "GBP Payment", 16.0, 0, "Test 1");
+    check_bucket(cube, 0, "USD FX.Forward", 8.0, 0, "Test 1");
+    check_bucket(cube, 0, "USD Payment", 4.0, 0, "Test 1");
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Maturity buckets are relative to today, and several rows are aggregated independently
+void test2(const portfolio_t& portfolio, const Date& today)
+{
+    RiskCube cube(portfolio, today, parse_group_by("maturity"));
+    cube.add({ { "PV", make_values() }, { "PV01", portfolio_values_t(portfolio.size(), trade_value(0.5)) } });
+
+    if (cube.rows() != 2 || cube.name(1) != "PV01" || cube.buckets() != 4)
+        throw std::runtime_error("Test 2 failed: unexpected size of the cube.");
+    check_bucket(cube, 0, "0-1Y", 13.0, 0, "Test 2");
+    check_bucket(cube, 0, "2Y-5Y", 2.0, 0, "Test 2");
+    check_bucket(cube, 0, "expired", 16.0, 0, "Test 2");
+    check_bucket(cube, 0, "10Y+", 0.0, 1, "Test 2");
+    check_bucket(cube, 1, "0-1Y", 1.5, 0, "Test 2");
+    check_bucket(cube, 1, "10Y+", 0.5, 0, "Test 2");
+
+    // without group-by keys, all trades are in a single bucket
+    RiskCube all(portfolio, today, parse_group_by(""));
+    all.add("PV", make_values());
+    if (all.buckets() != 1)
+        throw std::runtime_error("Test 2 failed: more than one bucket without group-by keys.");
+    check_bucket(all, 0, "All", 31.0, 1, "Test 2");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+// Invalid group-by keys and rows of the wrong size are rejected
+void test3(const portfolio_t& portfolio, const Date& today)
+{
+    bool thrown = false;
+    try {
+        parse_group_by("ccy,tenor");
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    if (!thrown)
+        throw std::runtime_error("Test 3 failed: unknown group-by key accepted.");
+
+    thrown = false;
+    RiskCube cube(portfolio, today, parse_group_by("ccy"));
+    try {
+        cube.add("PV", portfolio_values_t(portfolio.size() - 1, trade_value(1.0)));
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    if (!thrown)
+        throw std::runtime_error("Test 3 failed: row of the wrong size accepted.");
+
+    std::cout << "Test 3: SUCCESS" << std::endl;
+}
+
+
+int main()
+{
+    const Date today(2017, 8, 5);
+    portfolio_t portfolio = make_portfolio();
+
+    test1(portfolio, today);
+    test2(portfolio, today);
+    test3(portfolio, today);
+    return 0;
+}
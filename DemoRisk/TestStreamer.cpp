@@ -0,0 +1,141 @@
+#include <iostream>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "Streamer.h"
+
+using namespace minirisk;
+
+const string tmp_file = "test_streamer.tmp";
+
+void write_file(const string& content)
+{
+    my_ofstream of(tmp_file, std::ios::out | std::ios::binary);
+    of.write(content);
+}
+
+bool same_bits(double a, double b)
+{
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// Doubles written by the text writer (64 bits hexadecimal patterns) are read back bit by bit
+// identical, including special values and values whose pattern contains digits only.
+void test1()
+{
+    const double values[] = { 0.0, -0.0, 1.0, -1.5e+05, 1234567890123456.0, 1.0 / 3.0
+        , std::numeric_limits<double>::denorm_min(), std::numeric_limits<double>::max()
+        , std::numeric_limits<double>::infinity(), std::numeric_limits<double>::quiet_NaN()
+        , 2.0, 16.0 };  // 4000000000000000, 4030000000000000: digits only
+    {
+        my_ofstream of(tmp_file);
+        for (double v : values)
+            of << v;
+        of.endl();
+    }
+
+    my_ifstream is(tmp_file);
+    if (!is.read_line())
+        throw std::runtime_error("Test 1 failed: no line read.");
+    for (double v : values) {
+        double r;
+        is >> r;
+        if (!same_bits(r, v))
+            throw std::runtime_error("Test 1 failed: hexadecimal round trip of " + std::to_string(v) + " gives " + std::to_string(r));
+    }
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Decimal numbers are accepted when they contain a decimal point or start with a sign, so that
+// they cannot be mistaken for a hexadecimal pattern of the same length
+void test2()
+{
+    write_file("1234567890123456.0;-1.5e+05;+2.5;1.0000000000000000e+01;0.1;-3\n");
+    const double expected[] = { 1234567890123456.0, -1.5e+05, 2.5, 10.0, 0.1, -3.0 };
+
+    my_ifstream is(tmp_file);
+    is.read_line();
+    for (double e : expected) {
+        double r;
+        is >> r;
+        if (r != e)
+            throw std::runtime_error("Test 2 failed: decimal " + std::to_string(e) + " read as " + std::to_string(r));
+    }
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+// Tokens which are neither a hexadecimal pattern nor a decimal number with a decimal point or a
+// sign are rejected
+void test3()
+{
+    const char *invalid[] = { "20", "1e5", "12345678901234567", "zz00000000000000", "1.2.3", "-", "" };
+    for (const char *token : invalid) {
+        write_file(string(token) + ";\n");
+        my_ifstream is(tmp_file);
+        is.read_line();
+        double r;
+        bool thrown = false;
+        try {
+            is >> r;
+        }
+        catch (const std::exception&) {
+            thrown = true;
+        }
+        if (!thrown)
+            throw std::runtime_error(string("Test 3 failed: invalid number accepted: ") + token);
+    }
+
+    std::cout << "Test 3: SUCCESS" << std::endl;
+}
+
+// Tokenizer: integers, strings and dates (YYYYMMDD and serial formats), empty lines, Windows line
+// ends, a last line without line end and a line longer than the read buffer
+void test4()
+{
+    const string long_token(3 << 20, 'x');
+    write_file("42;EUR;20170805;42949;\r\n\n7;" + long_token + ";\n-5;last");
+
+    my_ifstream is(tmp_file);
+    unsigned u;
+    int i;
+    string s;
+    Date d1, d2;
+
+    if (!is.read_line())
+        throw std::runtime_error("Test 4 failed: first line not read.");
+    is >> u >> s >> d1 >> d2;
+    if (u != 42 || s != "EUR" || !(d1 == Date(2017, 8, 5)) || !(d2 == Date(2017, 8, 4)))
+        throw std::runtime_error("Test 4 failed: invalid tokens in the first line.");
+
+    if (is.read_line())
+        throw std::runtime_error("Test 4 failed: empty line not detected.");
+
+    if (!is.read_line())
+        throw std::runtime_error("Test 4 failed: long line not read.");
+    is >> u >> s;
+    if (u != 7 || s != long_token)
+        throw std::runtime_error("Test 4 failed: invalid tokens in the long line.");
+
+    if (!is.read_line())
+        throw std::runtime_error("Test 4 failed: last line not read.");
+    is >> i >> s;
+    if (i != -5 || s != "last")
+        throw std::runtime_error("Test 4 failed: invalid tokens in the last line.");
+
+    std::cout << "Test 4: SUCCESS" << std::endl;
+}
+
+
+int main()
+{
+    test1();
+    test2();
+    test3();
+    test4();
+    std::remove(tmp_file.c_str());
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <set>
+
+#include "SymbolTable.h"
+#include "ThreadPool.h"
+
+using namespace minirisk;
+
+// Identifiers are dense and sequential, interning a name twice gives the same identifier and
+// each identifier maps back to its name
+void test1()
+{
+    const size_t n = symbol_count();
+    const symbol_t eur = intern("IR.1Y.EUR");
+    const symbol_t usd = intern("IR.1Y.USD");
+    if (eur != n || usd != n + 1 || symbol_count() != n + 2)
+        throw std::runtime_error("Test 1 failed: identifiers are not assigned sequentially.");
+    if (intern("IR.1Y.EUR") != eur || find_symbol("IR.1Y.EUR") != eur || symbol_count() != n + 2)
+        throw std::runtime_error("Test 1 failed: name interned twice.");
+    if (symbol_name(eur) != "IR.1Y.EUR" || symbol_name(usd) != "IR.1Y.USD")
+        throw std::runtime_error("Test 1 failed: identifier not mapped back to its name.");
+    if (find_symbol("IR.2Y.EUR") != null_symbol || symbol_count() != n + 2)
+        throw std::runtime_error("Test 1 failed: find_symbol registered a name.");
+
+    bool thrown = false;
+    try {
+        symbol_name(static_cast<symbol_t>(symbol_count()));
+    }
+    catch (const std::exception&) {
+        thrown = true;
+    }
+    if (!thrown)
+        throw std::runtime_error("Test 1 failed: unknown identifier accepted.");
+
+    std::cout << "Test 1: SUCCESS" << std::endl;
+}
+
+// Names interned concurrently by several threads get one identifier each
+void test2()
+{
+    const size_t n_names = 1000;
+    const size_t n = symbol_count();
+    std::vector<std::vector<symbol_t>> ids(8, std::vector<symbol_t>(n_names));
+
+    ThreadPool pool(4);
+    pool.parallel_for(ids.size(), 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t t = begin; t < end; ++t)
+            for (size_t i = 0; i < n_names; ++i)
+                ids[t][i] = intern("TEST." + std::to_string((i + 37 * t) % n_names));
+    });
+
+    std::set<symbol_t> distinct;
+    for (size_t t = 0; t < ids.size(); ++t)
+        for (size_t i = 0; i < n_names; ++i) {
+            const string name = "TEST." + std::to_string((i + 37 * t) % n_names);
+            if (symbol_name(ids[t][i]) != name || find_symbol(name) != ids[t][i])
+                throw std::runtime_error("Test 2 failed: inconsistent identifier of " + name);
+            distinct.insert(ids[t][i]);
+        }
+    if (distinct.size() != n_names || symbol_count() != n + n_names
+        || *distinct.begin() != n || *distinct.rbegin() != n + n_names - 1)
+        throw std::runtime_error("Test 2 failed: identifiers are not dense.");
+
+    std::cout << "Test 2: SUCCESS" << std::endl;
+}
+
+
+int main()
+{
+    test1();
+    test2();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "ThreadPool.h"
+#include "Macros.h"
+
+#include <algorithm>
+
+namespace minirisk {
+
+ThreadPool::ThreadPool(unsigned n_threads)
+    : m_n_threads(std::max(1u, n_threads))
+    , m_ranges(new chunk_range_t[m_n_threads])
+{
+    m_threads.reserve(m_n_threads - 1);
+    for (unsigned i = 1; i < m_n_threads; ++i)
+        m_threads.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+    for (auto& t : m_threads)
+        t.join();
+}
+
+void ThreadPool::parallel_for(size_t n, size_t chunk_size, const std::function<void(size_t, size_t, unsigned)>& f)
+{
+    MYASSERT(chunk_size > 0, "Invalid chunk size");
+    MYASSERT(!m_job, "Parallel loops cannot be nested");
+    if (n == 0)
+        return;
+
+    job_t job{ n, chunk_size, &f, {}, 0, nullptr };
+
+    // distribute the chunks evenly over the threads, in contiguous ranges
+    const size_t n_chunks = (n + chunk_size - 1) / chunk_size;
+    for (unsigned t = 0; t < m_n_threads; ++t) {
+        m_ranges[t].m_begin = n_chunks * t / m_n_threads;
+        m_ranges[t].m_end = n_chunks * (t + 1) / m_n_threads;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_running = m_n_threads - 1;
+        ++m_generation;
+    }
+    m_start.notify_all();
+
+    work(0);
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_running == 0; });
+        m_job = nullptr;
+    }
+
+    if (job.error)
+        std::rethrow_exception(job.error);
+}
+
+bool ThreadPool::next_chunk(unsigned thread, size_t& chunk)
+{
+    {
+        chunk_range_t& r = m_ranges[thread];
+        std::lock_guard<std::mutex> lock(r.m_mutex);
+        if (r.m_begin < r.m_end) {
+            chunk = r.m_begin++;
+            return true;
+        }
+    }
+    for (unsigned i = 1; i < m_n_threads; ++i) {
+        chunk_range_t& r = m_ranges[(thread + i) % m_n_threads];
+        std::lock_guard<std::mutex> lock(r.m_mutex);
+        if (r.m_begin < r.m_end) {
+            chunk = --r.m_end;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::work(unsigned thread)
+{
+    job_t& job = *m_job;
+    size_t chunk;
+    while (next_chunk(thread, chunk)) {
+        size_t begin = chunk * job.chunk_size;
+        size_t end = std::min(job.n, begin + job.chunk_size);
+        try {
+            (*job.f)(begin, end, thread);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(job.error_mutex);
+            if (!job.error || chunk < job.error_chunk) {
+                job.error = std::current_exception();
+                job.error_chunk = chunk;
+            }
+        }
+    }
+}
+
+void ThreadPool::worker_loop(unsigned thread)
+{
+    unsigned generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&]() { return m_stop || m_generation != generation; });
+            if (m_stop)
+                return;
+            generation = m_generation;
+        }
+
+        work(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_running;
+        }
+        m_done.notify_one();
+    }
+}
+
+} // namespace minirisk
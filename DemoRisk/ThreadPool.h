@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <memory>
+
+namespace minirisk {
+
+// Fixed set of worker threads executing parallel loops, so that threads are spawned only once
+// and reused by all the phases of a computation.
+// The iteration range is split into chunks. Each thread starts from its own contiguous range of
+// chunks and, once it is exhausted, steals chunks from the back of the ranges of the other threads.
+struct ThreadPool
+{
+    // the calling thread takes part in the work, hence only n_threads-1 threads are spawned
+    explicit ThreadPool(unsigned n_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of threads taking part in a parallel loop, including the calling thread
+    unsigned size() const { return m_n_threads; }
+
+    // Calls f(begin, end, thread) for consecutive ranges of at most chunk_size items covering
+    // [0, n), where thread in [0, size()) identifies the thread executing the range, so that f
+    // can use per-thread state. Returns once all ranges have been processed.
+    // If f throws, the exception raised by the range with the lowest begin is rethrown.
+    // Parallel loops cannot be nested.
+    void parallel_for(size_t n, size_t chunk_size, const std::function<void(size_t, size_t, unsigned)>& f);
+
+private:
+    // range of chunks not yet processed owned by a thread
+    struct alignas(64) chunk_range_t
+    {
+        std::mutex m_mutex;
+        size_t m_begin = 0;
+        size_t m_end = 0;
+    };
+
+    struct job_t
+    {
+        size_t n;
+        size_t chunk_size;
+        const std::function<void(size_t, size_t, unsigned)> *f;
+        std::mutex error_mutex;
+        size_t error_chunk;
+        std::exception_ptr error;
+    };
+
+    // process chunks of the current job until there are no more left
+    void work(unsigned thread);
+
+    // take the next chunk from the own range, or steal one from another thread
+    bool next_chunk(unsigned thread, size_t& chunk);
+
+    // main loop of the spawned threads
+    void worker_loop(unsigned thread);
+
+    unsigned m_n_threads;
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<chunk_range_t[]> m_ranges;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;  // signalled when a new job is available or on shutdown
+    std::condition_variable m_done;   // signalled when a spawned thread completes its job
+    job_t *m_job = nullptr;
+    unsigned m_generation = 0;        // incremented for every new job
+    unsigned m_running = 0;           // spawned threads still working on the current job
+    bool m_stop = false;
+};
+
+} // namespace minirisk
@@ -0,0 +1,11 @@
+#include "TradeFXForward.h"
+#include "PricerFXForward.h"
+
+namespace minirisk {
+
+ppricer_t TradeFXForward::pricer(const string& base_ccy) const
+{
+    return ppricer_t(new PricerFXForward(*this, base_ccy));
+}
+
+} // namespace minirisk
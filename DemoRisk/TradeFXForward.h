@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Trade.h"
+
+namespace minirisk {
+
+// Exchange quantity units of the base currency for quantity * strike units of the quote
+// currency at the settlement date. The exchange rate is fixed at the fixing date.
+struct TradeFXForward : Trade<TradeFXForward>
+{
+    friend struct Trade<TradeFXForward>;
+
+    static const guid_t m_id;
+    static const std::string m_name;
+
+    TradeFXForward() {}
+
+    void init(const std::string& base_ccy, const std::string& quote_ccy, double quantity, double strike
+        , const Date& fixing_date, const Date& settlement_date)
+    {
+        Trade::init(quantity);
+        m_base_ccy = base_ccy;
+        m_quote_ccy = quote_ccy;
+        m_strike = strike;
+        m_fixing_date = fixing_date;
+        m_settlement_date = settlement_date;
+    }
+
+    virtual ppricer_t pricer(const string& base_ccy) const;
+
+    const string& base_ccy() const
+    {
+        return m_base_ccy;
+    }
+
+    const string& quote_ccy() const
+    {
+        return m_quote_ccy;
+    }
+
+    double strike() const
+    {
+        return m_strike;
+    }
+
+    const Date& fixing_date() const
+    {
+        return m_fixing_date;
+    }
+
+    const Date& settlement_date() const
+    {
+        return m_settlement_date;
+    }
+
+private:
+    void save_details(my_ofstream& os) const
+    {
+        os << m_base_ccy << m_quote_ccy << m_strike << m_fixing_date << m_settlement_date;
+    }
+
+    void load_details(my_ifstream& is)
+    {
+        is >> m_base_ccy >> m_quote_ccy >> m_strike >> m_fixing_date >> m_settlement_date;
+    }
+
+    void print_details(std::ostream& os) const
+    {
+        os << format_label("Strike level") << m_strike << std::endl;
+        os << format_label("Base Currency") << m_base_ccy << std::endl;
+        os << format_label("Quote Currency") << m_quote_ccy << std::endl;
+        os << format_label("Fixing Date") << m_fixing_date << std::endl;
+        os << format_label("Settlement Date") << m_settlement_date << std::endl;
+    }
+
+private:
+    string m_base_ccy;
+    string m_quote_ccy;
+    double m_strike;
+    Date m_fixing_date;
+    Date m_settlement_date;
+};
+
+} // namespace minirisk
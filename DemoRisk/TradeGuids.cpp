@@ -1,10 +1,14 @@
 #include "TradePayment.h"
+#include "TradeFXForward.h"
 
 namespace minirisk {
 
 const guid_t TradePayment::m_id = 0;
 const std::string TradePayment::m_name = "Payment";
 
+const guid_t TradeFXForward::m_id = 3;
+const std::string TradeFXForward::m_name = "FX.Forward";
+
 } // namespace minirisk
 
 